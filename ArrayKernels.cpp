@@ -0,0 +1,446 @@
+#include "ArrayKernels.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// The vector loops handle the largest multiple of the vector width,
+// and the plain loop at the end of every function picks up the rest.
+
+#if !defined(__AVX2__) && defined(__SSE2__)
+// 32 bit lane multiply, which SSE2 only has for the even lanes (as 64 bit products)
+static inline __m128i mulloInts(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+    return _mm_mullo_epi32(a, b);
+#else
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+#endif
+
+long long sumInts(const int* values, int n) {
+    long long total = 0;
+    int itr = 0;
+
+#if defined(__AVX2__)
+    // widen to 64 bit lanes before adding, so the sum can't overflow
+    __m256i acc = _mm256_setzero_si256();
+    for(; itr + 8 <= n; itr += 8){
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(values + itr));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(chunk)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(chunk, 1)));
+    }
+    long long lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, acc);
+    total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+    // no sign extending load in SSE2, so interleave with the sign mask instead
+    __m128i acc = _mm_setzero_si128();
+    for(; itr + 4 <= n; itr += 4){
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(values + itr));
+        __m128i sign = _mm_srai_epi32(chunk, 31);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(chunk, sign));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(chunk, sign));
+    }
+    long long lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    total = lanes[0] + lanes[1];
+#endif
+
+    for(; itr < n; itr++){
+        total += values[itr];
+    }
+    return total;
+}
+
+int minInts(const int* values, int n) {
+    int result = values[0];
+    int itr = 0;
+
+#if defined(__AVX2__)
+    if(n >= 8){
+        __m256i acc = _mm256_loadu_si256((const __m256i*)values);
+        for(itr = 8; itr + 8 <= n; itr += 8){
+            acc = _mm256_min_epi32(acc, _mm256_loadu_si256((const __m256i*)(values + itr)));
+        }
+        int lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        for(int lane = 0; lane < 8; lane++){
+            result = lanes[lane] < result ? lanes[lane] : result;
+        }
+    }
+#elif defined(__SSE2__)
+    if(n >= 4){
+        __m128i acc = _mm_loadu_si128((const __m128i*)values);
+        for(itr = 4; itr + 4 <= n; itr += 4){
+            __m128i chunk = _mm_loadu_si128((const __m128i*)(values + itr));
+#if defined(__SSE4_1__)
+            acc = _mm_min_epi32(acc, chunk);
+#else
+            __m128i chunk_smaller = _mm_cmpgt_epi32(acc, chunk);
+            acc = _mm_or_si128(_mm_and_si128(chunk_smaller, chunk), _mm_andnot_si128(chunk_smaller, acc));
+#endif
+        }
+        int lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        for(int lane = 0; lane < 4; lane++){
+            result = lanes[lane] < result ? lanes[lane] : result;
+        }
+    }
+#endif
+
+    for(; itr < n; itr++){
+        result = values[itr] < result ? values[itr] : result;
+    }
+    return result;
+}
+
+int maxInts(const int* values, int n) {
+    int result = values[0];
+    int itr = 0;
+
+#if defined(__AVX2__)
+    if(n >= 8){
+        __m256i acc = _mm256_loadu_si256((const __m256i*)values);
+        for(itr = 8; itr + 8 <= n; itr += 8){
+            acc = _mm256_max_epi32(acc, _mm256_loadu_si256((const __m256i*)(values + itr)));
+        }
+        int lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        for(int lane = 0; lane < 8; lane++){
+            result = lanes[lane] > result ? lanes[lane] : result;
+        }
+    }
+#elif defined(__SSE2__)
+    if(n >= 4){
+        __m128i acc = _mm_loadu_si128((const __m128i*)values);
+        for(itr = 4; itr + 4 <= n; itr += 4){
+            __m128i chunk = _mm_loadu_si128((const __m128i*)(values + itr));
+#if defined(__SSE4_1__)
+            acc = _mm_max_epi32(acc, chunk);
+#else
+            __m128i chunk_larger = _mm_cmpgt_epi32(chunk, acc);
+            acc = _mm_or_si128(_mm_and_si128(chunk_larger, chunk), _mm_andnot_si128(chunk_larger, acc));
+#endif
+        }
+        int lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        for(int lane = 0; lane < 4; lane++){
+            result = lanes[lane] > result ? lanes[lane] : result;
+        }
+    }
+#endif
+
+    for(; itr < n; itr++){
+        result = values[itr] > result ? values[itr] : result;
+    }
+    return result;
+}
+
+int countNonZeroInts(const int* values, int n) {
+    int zeros = 0;
+    int itr = 0;
+
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for(; itr + 8 <= n; itr += 8){
+        __m256i is_zero = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + itr)), zero);
+        zeros += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(is_zero)));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for(; itr + 4 <= n; itr += 4){
+        __m128i is_zero = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + itr)), zero);
+        zeros += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(is_zero)));
+    }
+#endif
+
+    for(; itr < n; itr++){
+        zeros += (values[itr] == 0);
+    }
+    return n - zeros;
+}
+
+int firstDifferentInt(const int* a, const int* b, int n) {
+    int itr = 0;
+
+#if defined(__AVX2__)
+    for(; itr + 8 <= n; itr += 8){
+        __m256i same = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(a + itr)), _mm256_loadu_si256((const __m256i*)(b + itr)));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(same));
+        if(mask != 0xFF){
+            return itr + __builtin_ctz(~mask);
+        }
+    }
+#elif defined(__SSE2__)
+    for(; itr + 4 <= n; itr += 4){
+        __m128i same = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + itr)), _mm_loadu_si128((const __m128i*)(b + itr)));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(same));
+        if(mask != 0xF){
+            return itr + __builtin_ctz(~mask);
+        }
+    }
+#endif
+
+    for(; itr < n; itr++){
+        if(a[itr] != b[itr]){
+            return itr;
+        }
+    }
+    return n;
+}
+
+unsigned long long hashInts(const int* values, int n, int first_index) {
+    unsigned long long total = 0;
+    int itr = 0;
+
+    // the same mixes as hashEntry, one lane per slot; the two halves of each
+    // lane are interleaved into 64 bit lanes and summed there
+#if defined(__AVX2__)
+    __m256i index = _mm256_add_epi32(_mm256_set1_epi32(first_index), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i acc = _mm256_setzero_si256();
+    for(; itr + 8 <= n; itr += 8){
+        __m256i val = _mm256_loadu_si256((const __m256i*)(values + itr));
+        __m256i low = _mm256_xor_si256(_mm256_mullo_epi32(val, _mm256_set1_epi32((int)0x9E3779B1u)), _mm256_mullo_epi32(index, _mm256_set1_epi32((int)0x85EBCA77u)));
+        low = _mm256_xor_si256(low, _mm256_srli_epi32(low, 15));
+        low = _mm256_mullo_epi32(low, _mm256_set1_epi32(0x2C1B3C6D));
+        low = _mm256_xor_si256(low, _mm256_srli_epi32(low, 12));
+        __m256i high = _mm256_xor_si256(_mm256_mullo_epi32(val, _mm256_set1_epi32((int)0xC2B2AE3Du)), _mm256_mullo_epi32(index, _mm256_set1_epi32(0x27D4EB2F)));
+        high = _mm256_xor_si256(high, _mm256_srli_epi32(high, 16));
+        high = _mm256_mullo_epi32(high, _mm256_set1_epi32(0x165667B1));
+        high = _mm256_xor_si256(high, _mm256_srli_epi32(high, 13));
+        __m256i is_zero = _mm256_cmpeq_epi32(val, _mm256_setzero_si256());
+        low = _mm256_andnot_si256(is_zero, low);
+        high = _mm256_andnot_si256(is_zero, high);
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(low, high));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(low, high));
+        index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+    }
+    unsigned long long lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, acc);
+    total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+    __m128i index = _mm_add_epi32(_mm_set1_epi32(first_index), _mm_setr_epi32(0, 1, 2, 3));
+    __m128i acc = _mm_setzero_si128();
+    for(; itr + 4 <= n; itr += 4){
+        __m128i val = _mm_loadu_si128((const __m128i*)(values + itr));
+        __m128i low = _mm_xor_si128(mulloInts(val, _mm_set1_epi32((int)0x9E3779B1u)), mulloInts(index, _mm_set1_epi32((int)0x85EBCA77u)));
+        low = _mm_xor_si128(low, _mm_srli_epi32(low, 15));
+        low = mulloInts(low, _mm_set1_epi32(0x2C1B3C6D));
+        low = _mm_xor_si128(low, _mm_srli_epi32(low, 12));
+        __m128i high = _mm_xor_si128(mulloInts(val, _mm_set1_epi32((int)0xC2B2AE3Du)), mulloInts(index, _mm_set1_epi32(0x27D4EB2F)));
+        high = _mm_xor_si128(high, _mm_srli_epi32(high, 16));
+        high = mulloInts(high, _mm_set1_epi32(0x165667B1));
+        high = _mm_xor_si128(high, _mm_srli_epi32(high, 13));
+        __m128i is_zero = _mm_cmpeq_epi32(val, _mm_setzero_si128());
+        low = _mm_andnot_si128(is_zero, low);
+        high = _mm_andnot_si128(is_zero, high);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(low, high));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(low, high));
+        index = _mm_add_epi32(index, _mm_set1_epi32(4));
+    }
+    unsigned long long lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    total = lanes[0] + lanes[1];
+#endif
+
+    for(; itr < n; itr++){
+        total += hashEntry((int)((unsigned int)first_index + (unsigned int)itr), values[itr]);
+    }
+    return total;
+}
+
+void addIntsInto(int* dst, const int* src, int n) {
+    int itr = 0;
+
+#if defined(__AVX2__)
+    for(; itr + 8 <= n; itr += 8){
+        __m256i sum = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(dst + itr)), _mm256_loadu_si256((const __m256i*)(src + itr)));
+        _mm256_storeu_si256((__m256i*)(dst + itr), sum);
+    }
+#elif defined(__SSE2__)
+    for(; itr + 4 <= n; itr += 4){
+        __m128i sum = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(dst + itr)), _mm_loadu_si128((const __m128i*)(src + itr)));
+        _mm_storeu_si128((__m128i*)(dst + itr), sum);
+    }
+#endif
+
+    for(; itr < n; itr++){
+        dst[itr] = (int)((unsigned int)dst[itr] + (unsigned int)src[itr]);
+    }
+}
+
+void maxIntsInto(int* dst, const int* src, int n) {
+    int itr = 0;
+
+#if defined(__AVX2__)
+    for(; itr + 8 <= n; itr += 8){
+        __m256i larger = _mm256_max_epi32(_mm256_loadu_si256((const __m256i*)(dst + itr)), _mm256_loadu_si256((const __m256i*)(src + itr)));
+        _mm256_storeu_si256((__m256i*)(dst + itr), larger);
+    }
+#elif defined(__SSE2__)
+    for(; itr + 4 <= n; itr += 4){
+        __m128i current = _mm_loadu_si128((const __m128i*)(dst + itr));
+        __m128i other = _mm_loadu_si128((const __m128i*)(src + itr));
+#if defined(__SSE4_1__)
+        __m128i larger = _mm_max_epi32(current, other);
+#else
+        __m128i other_larger = _mm_cmpgt_epi32(other, current);
+        __m128i larger = _mm_or_si128(_mm_and_si128(other_larger, other), _mm_andnot_si128(other_larger, current));
+#endif
+        _mm_storeu_si128((__m128i*)(dst + itr), larger);
+    }
+#endif
+
+    for(; itr < n; itr++){
+        dst[itr] = src[itr] > dst[itr] ? src[itr] : dst[itr];
+    }
+}
+
+void minIntsInto(int* dst, const int* src, int n) {
+    int itr = 0;
+
+#if defined(__AVX2__)
+    for(; itr + 8 <= n; itr += 8){
+        __m256i smaller = _mm256_min_epi32(_mm256_loadu_si256((const __m256i*)(dst + itr)), _mm256_loadu_si256((const __m256i*)(src + itr)));
+        _mm256_storeu_si256((__m256i*)(dst + itr), smaller);
+    }
+#elif defined(__SSE2__)
+    for(; itr + 4 <= n; itr += 4){
+        __m128i current = _mm_loadu_si128((const __m128i*)(dst + itr));
+        __m128i other = _mm_loadu_si128((const __m128i*)(src + itr));
+#if defined(__SSE4_1__)
+        __m128i smaller = _mm_min_epi32(current, other);
+#else
+        __m128i other_smaller = _mm_cmpgt_epi32(current, other);
+        __m128i smaller = _mm_or_si128(_mm_and_si128(other_smaller, other), _mm_andnot_si128(other_smaller, current));
+#endif
+        _mm_storeu_si128((__m128i*)(dst + itr), smaller);
+    }
+#endif
+
+    for(; itr < n; itr++){
+        dst[itr] = src[itr] < dst[itr] ? src[itr] : dst[itr];
+    }
+}
+
+double dotInts(const int* values, const double* x, int n) {
+    double total = 0;
+    int itr = 0;
+
+#if defined(__AVX2__)
+    // two accumulators, so consecutive multiply-adds don't wait on each other
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    for(; itr + 8 <= n; itr += 8){
+        __m256d low = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(values + itr)));
+        __m256d high = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(values + itr + 4)));
+#if defined(__FMA__)
+        acc0 = _mm256_fmadd_pd(low, _mm256_loadu_pd(x + itr), acc0);
+        acc1 = _mm256_fmadd_pd(high, _mm256_loadu_pd(x + itr + 4), acc1);
+#else
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(low, _mm256_loadu_pd(x + itr)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(high, _mm256_loadu_pd(x + itr + 4)));
+#endif
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__SSE2__)
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for(; itr + 4 <= n; itr += 4){
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(values + itr));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_cvtepi32_pd(chunk), _mm_loadu_pd(x + itr)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(chunk, 8)), _mm_loadu_pd(x + itr + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    total = lanes[0] + lanes[1];
+#endif
+
+    for(; itr < n; itr++){
+        total += values[itr] * x[itr];
+    }
+    return total;
+}
+
+double gatherDotInts(const int* columns, const int* values, const double* x, int n) {
+    double total = 0;
+    int itr = 0;
+
+#if defined(__AVX2__)
+    __m256d acc = _mm256_setzero_pd();
+    for(; itr + 4 <= n; itr += 4){
+        // the masked form with a zeroed source, so no lane reads an uninitialised register
+        __m256d gathered = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, _mm_loadu_si128((const __m128i*)(columns + itr)),
+                                                    _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+        __m256d chunk = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(values + itr)));
+#if defined(__FMA__)
+        acc = _mm256_fmadd_pd(chunk, gathered, acc);
+#else
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(chunk, gathered));
+#endif
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+    for(; itr < n; itr++){
+        total += values[itr] * x[columns[itr]];
+    }
+    return total;
+}
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// value of 8 decimal digits, one per byte (already minus '0'), the first one in the lowest byte
+static inline unsigned int eightDigitsValue(uint64_t digits) {
+    digits = (digits * 10) + (digits >> 8);   // pairs of digits
+    return (unsigned int)(((digits & 0x000000FF000000FFull) * (100 + (1000000ull << 32)) +
+                          ((digits >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32))) >> 32);
+}
+#endif
+
+const char* parseInt(const char* p, const char* end, int& val) {
+    bool negative = (p < end) && (*p == '-');
+    p += negative;
+    const char* first_digit = p;
+    unsigned long long magnitude = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // find the run of digits among the next 8 bytes without carries between bytes
+    // (a byte is no digit if it has the high bit set, is above '9' or is below '0'),
+    // then shift the digits to the top so the bytes below them read as leading zeros
+    if(end - p >= 8){
+        const uint64_t high_bits = 0x8080808080808080ull;
+        uint64_t chunk;
+        memcpy(&chunk, p, 8);
+        uint64_t not_digit = (chunk | ((chunk & ~high_bits) + 0x4646464646464646ull) | ~((chunk | high_bits) - 0x3030303030303030ull)) & high_bits;
+        int count = (not_digit == 0) ? 8 : (__builtin_ctzll(not_digit) >> 3);
+        if(count == 0){
+            return nullptr;
+        }
+        magnitude = eightDigitsValue((chunk - 0x3030303030303030ull) << (8 * (8 - count)));
+        p += count;
+    }
+#endif
+
+    // what is left: numbers near the end of the text, and the 9th and 10th digit
+    while((p < end) && ((unsigned char)(*p - '0') < 10) && (p - first_digit < 10)){
+        magnitude = magnitude * 10 + (unsigned char)(*p - '0');
+        p++;
+    }
+    if((p == first_digit) || ((p < end) && ((unsigned char)(*p - '0') < 10))){
+        return nullptr;
+    }
+    if(magnitude > 2147483647ull + negative){
+        return nullptr;
+    }
+    val = negative ? (int)(-(long long)magnitude) : (int)magnitude;
+    return p;
+}
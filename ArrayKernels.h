@@ -0,0 +1,67 @@
+#ifndef ARRAYKERNELS_H_
+#define ARRAYKERNELS_H_
+
+// Loops over plain int arrays used by HybridTable for its array part.
+// Each one has an AVX2 and an SSE2 version picked at compile time (SSE2
+// is always there on x86-64, build with -mavx2 for the 8 lane versions),
+// and a plain loop for other targets. parseInt() scans text instead, 8
+// bytes at a time in a 64 bit register.
+
+// Returns values[0] + ... + values[n-1], without overflowing.
+long long sumInts(const int* values, int n);
+
+// Returns the smallest of values[0..n-1]. n must be at least 1.
+int minInts(const int* values, int n);
+
+// Returns the largest of values[0..n-1]. n must be at least 1.
+int maxInts(const int* values, int n);
+
+// Returns how many of values[0..n-1] are not 0.
+int countNonZeroInts(const int* values, int n);
+
+// Returns the first i in [0..n-1] with a[i] != b[i], or n if there is none.
+int firstDifferentInt(const int* a, const int* b, int n);
+
+// Hash of one (index, val) entry: two independent 32 bit mixes side by
+// side. It is 0 when val is 0, so an entry holding 0 hashes like a
+// missing one.
+inline unsigned long long hashEntry(int index, int val) {
+	unsigned int low = ((unsigned int)val * 0x9E3779B1u) ^ ((unsigned int)index * 0x85EBCA77u);
+	low ^= low >> 15;
+	low *= 0x2C1B3C6Du;
+	low ^= low >> 12;
+	unsigned int high = ((unsigned int)val * 0xC2B2AE3Du) ^ ((unsigned int)index * 0x27D4EB2Fu);
+	high ^= high >> 16;
+	high *= 0x165667B1u;
+	high ^= high >> 13;
+	return (val != 0) ? (((unsigned long long)high << 32) | low) : 0;
+}
+
+// Returns the sum of hashEntry(first_index + i, values[i]) over
+// i in [0..n-1], wrapping around on overflow.
+unsigned long long hashInts(const int* values, int n, int first_index);
+
+// dst[i] = dst[i] + src[i] for i in [0..n-1], wrapping around on overflow.
+void addIntsInto(int* dst, const int* src, int n);
+
+// dst[i] = the larger of dst[i] and src[i] for i in [0..n-1].
+void maxIntsInto(int* dst, const int* src, int n);
+
+// dst[i] = the smaller of dst[i] and src[i] for i in [0..n-1].
+void minIntsInto(int* dst, const int* src, int n);
+
+// Returns values[0] * x[0] + ... + values[n-1] * x[n-1], with fused
+// multiply-adds where the target has them (-mfma).
+double dotInts(const int* values, const double* x, int n);
+
+// Returns values[0] * x[columns[0]] + ... + values[n-1] * x[columns[n-1]],
+// gathering 4 entries of x at a time with AVX2.
+double gatherDotInts(const int* columns, const int* values, const double* x, int n);
+
+// Parses a decimal int (digits with an optional leading '-') starting at
+// p, reading no further than end. Returns the position just past it and
+// sets val, or returns nullptr if there is no number at p or it does not
+// fit in an int.
+const char* parseInt(const char* p, const char* end, int& val);
+
+#endif /* ARRAYKERNELS_H_ */
@@ -0,0 +1,249 @@
+#include "CompressedHybridTable.h"
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+CompressedHybridTable::CompressedHybridTable() {
+    array_size_ = HybridTable::INITIAL_ARRAY_SIZE;
+    blocks_.resize(1);
+    blocks_[0].runs.push_back(Run{0, 0});
+}
+
+CompressedHybridTable::CompressedHybridTable(const HybridTable& table) {
+    HybridTableColumns columns = table.exportColumns();
+    array_size_ = (int)columns.array_values.size();
+    blocks_.resize(((size_t)array_size_ + BLOCK_SIZE - 1) >> BLOCK_SHIFT);
+    for(size_t b = 0; b < blocks_.size(); b++){
+        encodeBlock(blocks_[b], columns.array_values.data() + (b << BLOCK_SHIFT), blockLength(b));
+    }
+    list_.reserve(columns.list_indices.size());
+    for(size_t itr = 0; itr < columns.list_indices.size(); itr++){
+        list_.push_back(make_pair(columns.list_indices[itr], columns.list_values[itr]));
+    }
+    policy_ = table.getPolicy();
+}
+
+int CompressedHybridTable::get(int i) const {
+    if((i >= 0) && (i < array_size_)){
+        const Block& block = blocks_[i >> BLOCK_SHIFT];
+        int offset = i & (BLOCK_SIZE - 1);
+        if(!block.slots.empty()){
+            return block.slots[offset];
+        }
+        // the last run starting at or before offset
+        auto run = upper_bound(block.runs.begin(), block.runs.end(), offset, [](int slot, const Run& block_run){
+            return slot < block_run.start;
+        });
+        return (run - 1)->val;
+    }
+
+    auto entry = lower_bound(list_.begin(), list_.end(), make_pair(i, INT_MIN));
+    if((entry != list_.end()) && (entry->first == i)){
+        return entry->second;
+    }
+    return 0;
+}
+
+void CompressedHybridTable::set(int i, int val) {
+    if((i >= 0) && (i < array_size_)){
+        writeSlot(i, val);
+        return;
+    }
+    auto entry = lower_bound(list_.begin(), list_.end(), make_pair(i, INT_MIN));
+    if((entry != list_.end()) && (entry->first == i)){
+        entry->second = val;
+        return;
+    }
+
+    // introduce the new value into the list and then check for the resizing of array
+    size_t position = entry - list_.begin();
+    int new_array_size = calcNewArraySize(i, position);
+    list_.insert(list_.begin() + position, make_pair(i, val));
+    if(new_array_size > array_size_){
+        resizeArray(new_array_size);
+    }
+}
+
+int CompressedHybridTable::getArraySize() const {
+    return array_size_;
+}
+
+int CompressedHybridTable::getTotalSize() const {
+    return array_size_ + (int)list_.size();
+}
+
+template<typename F>
+void CompressedHybridTable::forEachArraySlot(F f) const {
+    for(size_t b = 0; b < blocks_.size(); b++){
+        const Block& block = blocks_[b];
+        if(!block.slots.empty()){
+            for(int val : block.slots){
+                f(val);
+            }
+            continue;
+        }
+        int length = blockLength(b);
+        for(size_t itr = 0; itr < block.runs.size(); itr++){
+            int run_end = (itr + 1 < block.runs.size()) ? block.runs[itr + 1].start : length;
+            for(int offset = block.runs[itr].start; offset < run_end; offset++){
+                f(block.runs[itr].val);
+            }
+        }
+    }
+}
+
+string CompressedHybridTable::toString() const {
+    string out_string;
+    int itr = 0;
+    forEachArraySlot([&](int val){
+        out_string += to_string(itr) + " : " + to_string(val);
+        if(itr < array_size_ - 1){
+            out_string += "\n";
+        }
+        itr++;
+    });
+    if(!list_.empty()){
+        out_string += "\n---\n";
+        for(size_t entry = 0; entry < list_.size(); entry++){
+            if(entry != 0){
+                out_string += " --> ";
+            }
+            out_string += to_string(list_[entry].first) + " : " + to_string(list_[entry].second);
+        }
+    }
+    return out_string;
+}
+
+HybridTable CompressedHybridTable::decompress() const {
+    vector<int> array_values;
+    array_values.reserve(array_size_);
+    forEachArraySlot([&](int val){
+        array_values.push_back(val);
+    });
+    HybridTableColumns columns;
+    columns.array_values = span<const int>(array_values.data(), array_values.size());
+    for(const pair<int, int>& entry : list_){
+        columns.list_indices.push_back(entry.first);
+        columns.list_values.push_back(entry.second);
+    }
+
+    HybridTable table;
+    table.setPolicy(policy_);
+    table.importColumns(columns);
+    return table;
+}
+
+void CompressedHybridTable::recompress() {
+    for(Block& block : blocks_){
+        if(!block.slots.empty()){
+            vector<int> slots;
+            slots.swap(block.slots);
+            encodeBlock(block, slots.data(), (int)slots.size());
+        }
+    }
+}
+
+int CompressedHybridTable::getExpandedBlockCount() const {
+    int count = 0;
+    for(const Block& block : blocks_){
+        count += !block.slots.empty();
+    }
+    return count;
+}
+
+HybridTableMemoryUsage CompressedHybridTable::memoryUsage() const {
+    HybridTableMemoryUsage usage;
+    usage.array_bytes = blocks_.capacity() * sizeof(Block);
+    for(const Block& block : blocks_){
+        usage.array_bytes += block.runs.capacity() * sizeof(Run) + block.slots.capacity() * sizeof(int);
+    }
+    usage.sparse_bytes = list_.capacity() * sizeof(pair<int, int>);
+    usage.overhead_bytes = sizeof(CompressedHybridTable);
+    return usage;
+}
+
+int CompressedHybridTable::blockLength(size_t b) const {
+    return (int)std::min((long long)BLOCK_SIZE, (long long)array_size_ - ((long long)b << BLOCK_SHIFT));
+}
+
+void CompressedHybridTable::encodeBlock(Block& block, const int* values, int length) {
+    block.runs.clear();
+    for(int itr = 0; itr < length; itr++){
+        if((itr == 0) || (values[itr] != values[itr - 1])){
+            block.runs.push_back(Run{itr, values[itr]});
+        }
+    }
+
+    // runs take two ints each, so they only pay off below half as many runs as slots
+    if(block.runs.size() * sizeof(Run) < (size_t)length * sizeof(int)){
+        block.runs.shrink_to_fit();
+        vector<int>().swap(block.slots);
+    }
+    else{
+        vector<Run>().swap(block.runs);
+        block.slots.assign(values, values + length);
+    }
+}
+
+void CompressedHybridTable::writeSlot(int i, int val) {
+    Block& block = blocks_[i >> BLOCK_SHIFT];
+    int offset = i & (BLOCK_SIZE - 1);
+    if(block.slots.empty()){
+        auto run = upper_bound(block.runs.begin(), block.runs.end(), offset, [](int slot, const Run& block_run){
+            return slot < block_run.start;
+        }) - 1;
+        if(run->val == val){
+            return;
+        }
+
+        // the block no longer matches its runs
+        block.slots.resize(blockLength(i >> BLOCK_SHIFT));
+        for(size_t itr = 0; itr < block.runs.size(); itr++){
+            int run_end = (itr + 1 < block.runs.size()) ? block.runs[itr + 1].start : (int)block.slots.size();
+            fill(block.slots.begin() + block.runs[itr].start, block.slots.begin() + run_end, block.runs[itr].val);
+        }
+        vector<Run>().swap(block.runs);
+    }
+    block.slots[offset] = val;
+}
+
+int CompressedHybridTable::calcNewArraySize(int i, size_t position) const {
+    // every slot counts as used, as in a HybridTable without the presence bitmap
+    HybridTable::GrowthScan scan = HybridTable::startGrowthScan(policy_, array_size_, array_size_);
+    for(size_t itr = 0; itr <= list_.size(); itr++){
+        int index = (itr < position) ? list_[itr].first : (itr == position) ? i : list_[itr - 1].first;
+        HybridTable::scanIndex(policy_, scan, index);
+    }
+    return scan.out_size;
+}
+
+void CompressedHybridTable::resizeArray(int size) {
+    // the new slots are 0: a short last block gets a run or slots of 0, new blocks one run of 0
+    int old_size = array_size_;
+    array_size_ = size;
+    if(!blocks_.empty()){
+        Block& last_block = blocks_.back();
+        int old_length = old_size - (int)((blocks_.size() - 1) << BLOCK_SHIFT);
+        if(!last_block.slots.empty()){
+            last_block.slots.resize(blockLength(blocks_.size() - 1), 0);
+        }
+        else if((last_block.runs.back().val != 0) && (old_length < blockLength(blocks_.size() - 1))){
+            last_block.runs.push_back(Run{old_length, 0});
+        }
+    }
+    size_t block_count = ((size_t)size + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+    while(blocks_.size() < block_count){
+        blocks_.emplace_back();
+        blocks_.back().runs.push_back(Run{0, 0});
+    }
+
+    // list entries now inside the array part move there
+    auto first = lower_bound(list_.begin(), list_.end(), make_pair(0, INT_MIN));
+    auto last = first;
+    while((last != list_.end()) && (last->first < size)){
+        writeSlot(last->first, last->second);
+        last++;
+    }
+    list_.erase(first, last);
+}
@@ -0,0 +1,100 @@
+#ifndef COMPRESSEDHYBRIDTABLE_H_
+#define COMPRESSEDHYBRIDTABLE_H_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "HybridTable.h"
+
+// A HybridTable whose array part is run length compressed, for tables
+// where long stretches of the array part hold the same value. The array
+// part is cut into blocks of BLOCK_SIZE slots; a block either keeps its
+// runs of equal values as (start, value) pairs, found by binary search,
+// or, once a write made it differ from its runs, a plain array of its
+// slots. A write that leaves a slot unchanged never expands a block, and
+// recompress() turns expanded blocks back into runs where that saves
+// memory. The list part, the growth rule and get()/set()/toString()
+// behave exactly like those of the HybridTable it was made from (every
+// array slot counts as used, as without the presence bitmap).
+class CompressedHybridTable {
+
+public:
+	static constexpr int BLOCK_SHIFT = 12;
+	static constexpr int BLOCK_SIZE = 1 << BLOCK_SHIFT;
+
+	// Constructs an empty table, like HybridTable().
+	CompressedHybridTable();
+
+	// Constructs a compressed copy of table (its policy included).
+	explicit CompressedHybridTable(const HybridTable& table);
+
+	// Same as HybridTable::get(i).
+	int get(int i) const;
+
+	// Same as HybridTable::set(i, val). Expands the block holding i if
+	// val is not the value already there.
+	void set(int i, int val);
+
+	// Same as HybridTable::getArraySize().
+	int getArraySize() const;
+
+	// Same as HybridTable::getTotalSize().
+	int getTotalSize() const;
+
+	// Same as HybridTable::toString().
+	std::string toString() const;
+
+	// Returns a plain HybridTable with the same contents, split between
+	// the parts the same way.
+	HybridTable decompress() const;
+
+	// Re-encodes expanded blocks as runs wherever the runs are smaller.
+	void recompress();
+
+	// Returns the number of blocks currently stored as plain arrays.
+	int getExpandedBlockCount() const;
+
+	// Returns the number of bytes used, split like HybridTable::memoryUsage().
+	HybridTableMemoryUsage memoryUsage() const;
+
+private:
+
+    // slots [start, start of the next run) of a block hold val
+    struct Run {
+        int start;
+        int val;
+    };
+
+    // exactly one of runs and slots is in use
+    struct Block {
+        std::vector<Run> runs;
+        std::vector<int> slots;
+    };
+
+    int array_size_ = 0;
+    std::vector<Block> blocks_;                // ceil(array_size_ / BLOCK_SIZE) blocks
+    std::vector<std::pair<int, int>> list_;    // list part, sorted by index
+    HybridTablePolicy policy_;
+
+    // returns the size of block b (the last one may be short)
+    int blockLength(size_t b) const;
+
+    // encodes values[0..length-1] as block, as runs if that is smaller
+    static void encodeBlock(Block& block, const int* values, int length);
+
+    // writes val to array slot i, expanding its block if needed
+    void writeSlot(int i, int val);
+
+    // HybridTable::calcNewArraySize() with index i about to be inserted at list position
+    int calcNewArraySize(int i, size_t position) const;
+
+    // grows the array part to size slots and moves the list entries that now fit into it
+    void resizeArray(int size);
+
+    // calls f(val) for array slots 0..array_size_-1, in order
+    template<typename F>
+    void forEachArraySlot(F f) const;
+};
+
+#endif /* COMPRESSEDHYBRIDTABLE_H_ */
@@ -0,0 +1,101 @@
+#include "ConcurrentHybridTable.h"
+#include <atomic>
+
+using namespace std;
+
+ConcurrentHybridTable::ConcurrentHybridTable() {
+
+}
+
+ConcurrentHybridTable::ConcurrentHybridTable(const HybridTable& table) : table_(table) {
+
+}
+
+int ConcurrentHybridTable::get(int i) const {
+    shared_lock<shared_mutex> lock(mutex_);
+    if((i < table_.total_array_size) && (i >= 0)){
+        // the slot may be written atomically by another holder of the shared lock
+        return atomic_ref<int>(table_.array_[i]).load(memory_order_relaxed);
+    }
+    return table_.get(i);
+}
+
+void ConcurrentHybridTable::set(int i, int val) {
+    {
+        shared_lock<shared_mutex> lock(mutex_);
+        int* slot = atomicSlot(i);
+        if(slot != nullptr){
+            atomic_ref<int>(*slot).store(val, memory_order_relaxed);
+            return;
+        }
+    }
+    unique_lock<shared_mutex> lock(mutex_);
+    table_.set(i, val);
+}
+
+int ConcurrentHybridTable::add(int i, int delta) {
+    return (int)((unsigned int)fetchAdd(i, delta) + (unsigned int)delta);
+}
+
+int ConcurrentHybridTable::fetchAdd(int i, int delta) {
+    {
+        shared_lock<shared_mutex> lock(mutex_);
+        int* slot = atomicSlot(i);
+        if(slot != nullptr){
+            return atomic_ref<int>(*slot).fetch_add(delta, memory_order_relaxed);
+        }
+    }
+    unique_lock<shared_mutex> lock(mutex_);
+    return table_.fetchAdd(i, delta);
+}
+
+int ConcurrentHybridTable::exchange(int i, int val) {
+    {
+        shared_lock<shared_mutex> lock(mutex_);
+        int* slot = atomicSlot(i);
+        if(slot != nullptr){
+            return atomic_ref<int>(*slot).exchange(val, memory_order_relaxed);
+        }
+    }
+    unique_lock<shared_mutex> lock(mutex_);
+    return table_.exchange(i, val);
+}
+
+bool ConcurrentHybridTable::compareExchange(int i, int& expected, int desired) {
+    {
+        shared_lock<shared_mutex> lock(mutex_);
+        int* slot = atomicSlot(i);
+        if(slot != nullptr){
+            return atomic_ref<int>(*slot).compare_exchange_strong(expected, desired, memory_order_relaxed);
+        }
+    }
+    unique_lock<shared_mutex> lock(mutex_);
+    return table_.compareExchange(i, expected, desired);
+}
+
+void ConcurrentHybridTable::merge(const HybridTable& other, MergeCombiner combiner) {
+    unique_lock<shared_mutex> lock(mutex_);
+    table_.merge(other, combiner);
+}
+
+HybridTable ConcurrentHybridTable::copy() const {
+    unique_lock<shared_mutex> lock(mutex_);
+    return table_;
+}
+
+string ConcurrentHybridTable::toString() const {
+    unique_lock<shared_mutex> lock(mutex_);
+    return table_.toString();
+}
+
+int ConcurrentHybridTable::getTotalSize() const {
+    shared_lock<shared_mutex> lock(mutex_);
+    return table_.getTotalSize();
+}
+
+int* ConcurrentHybridTable::atomicSlot(int i) const {
+    if((i < table_.total_array_size) && (i >= 0) && table_.hasPlainArrayWrites()){
+        return &table_.array_[i];
+    }
+    return nullptr;
+}
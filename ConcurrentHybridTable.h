@@ -0,0 +1,85 @@
+#ifndef CONCURRENTHYBRIDTABLE_H_
+#define CONCURRENTHYBRIDTABLE_H_
+
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include "HybridTable.h"
+
+// A HybridTable shared between threads: reads take a shared lock, writes
+// an exclusive one. Threads doing many small writes should go through a
+// HybridTableWriter, which takes the lock once per batch.
+// Writes to the array part (set, add, fetchAdd, exchange, compareExchange)
+// only take the shared lock and update the slot with std::atomic_ref, so
+// counters in the dense range scale across cores; they fall back to the
+// exclusive lock outside the array part, or when the table keeps a prefix
+// index, presence bitmap, journal or snapshot that must see every write.
+class ConcurrentHybridTable {
+
+public:
+	// Constructs an empty table, like HybridTable().
+	ConcurrentHybridTable();
+
+	// Constructs a table holding a copy of table.
+	explicit ConcurrentHybridTable(const HybridTable& table);
+
+	ConcurrentHybridTable(const ConcurrentHybridTable&) = delete;
+	ConcurrentHybridTable& operator=(const ConcurrentHybridTable&) = delete;
+
+	// HybridTable::get() under the shared lock.
+	int get(int i) const;
+
+	// HybridTable::set().
+	void set(int i, int val);
+
+	// HybridTable::add().
+	int add(int i, int delta);
+
+	// HybridTable::fetchAdd().
+	int fetchAdd(int i, int delta);
+
+	// HybridTable::exchange().
+	int exchange(int i, int val);
+
+	// HybridTable::compareExchange().
+	bool compareExchange(int i, int& expected, int desired);
+
+	// HybridTable::merge() under the exclusive lock.
+	void merge(const HybridTable& other, MergeCombiner combiner);
+
+	// Returns a copy of the table as it is now (under the exclusive lock,
+	// so no atomic array writes are halfway).
+	HybridTable copy() const;
+
+	// HybridTable::toString() under the exclusive lock.
+	std::string toString() const;
+
+	// HybridTable::getTotalSize() under the shared lock.
+	int getTotalSize() const;
+
+	// Calls f(const HybridTable&) under the exclusive lock (array slots may
+	// be written under the shared one) and returns its result.
+	template<typename F>
+	auto read(F f) const -> decltype(f(std::declval<const HybridTable&>())) {
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		return f(static_cast<const HybridTable&>(table_));
+	}
+
+	// Calls f(HybridTable&) under the exclusive lock and returns its result.
+	template<typename F>
+	auto update(F f) -> decltype(f(std::declval<HybridTable&>())) {
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		return f(table_);
+	}
+
+private:
+
+	mutable std::shared_mutex mutex_;
+	HybridTable table_;
+
+	// returns the array slot of index i if it may be written atomically under
+	// the shared lock, nullptr otherwise; the shared lock must be held
+	int* atomicSlot(int i) const;
+};
+
+#endif /* CONCURRENTHYBRIDTABLE_H_ */
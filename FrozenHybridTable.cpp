@@ -0,0 +1,200 @@
+#include "FrozenHybridTable.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <utility>
+
+using namespace std;
+
+// first bytes of a serialized FrozenHybridTable
+static const char FROZEN_MAGIC[4] = {'H', 'T', 'F', '1'};
+
+// deserialize() reads at most this many ints at a time
+static const size_t READ_CHUNK = 1 << 16;
+
+// appends count ints from in to out a chunk at a time, so a damaged size in
+// a header costs no more memory than the stream actually holds
+static bool readInts(istream& in, vector<int>& out, unsigned long long count) {
+    size_t start = out.size();
+    while(count > 0){
+        size_t piece = (size_t)min<unsigned long long>(count, READ_CHUNK);
+        out.resize(start + piece);
+        if(!in.read((char*)(out.data() + start), piece * sizeof(int))){
+            return false;
+        }
+        start += piece;
+        count -= piece;
+    }
+    return true;
+}
+
+FrozenHybridTable::FrozenHybridTable() {
+    keys_.assign(1, 0);
+    values_.assign(1, 0);
+}
+
+FrozenHybridTable::FrozenHybridTable(const int* arr, int n, const int* indices, const int* values, size_t count) {
+    array_.assign(arr, arr + n);
+    keys_.assign(count + 1, 0);
+    values_.assign(count + 1, 0);
+    fillEytzinger(indices, values, 0, 1);
+}
+
+int FrozenHybridTable::get(int i) const {
+    if((i >= 0) && (i < (int)array_.size())){
+        return array_[i];
+    }
+
+    size_t position = lowerBound(i);
+    if((position != 0) && (keys_[position] == i)){
+        return values_[position];
+    }
+    return 0;
+}
+
+void FrozenHybridTable::getMany(const int* indices, int* out, size_t count) const {
+    for(size_t itr = 0; itr < count; itr++){
+        out[itr] = get(indices[itr]);
+    }
+}
+
+int FrozenHybridTable::getArraySize() const {
+    return (int)array_.size();
+}
+
+int FrozenHybridTable::getTotalSize() const {
+    return (int)(array_.size() + listSize());
+}
+
+string FrozenHybridTable::toString() const {
+    string out_string;
+
+    for(size_t itr = 0; itr < array_.size(); itr++){
+        out_string += to_string(itr) + " : " + to_string(array_[itr]);
+        if(itr < array_.size() - 1){
+            out_string += "\n";
+        }
+    }
+    if(listSize() == 0){
+        return out_string;
+    }
+
+    out_string += "\n---\n";
+    size_t position = lowerBound(INT_MIN);
+    bool first = true;
+    while(position != 0){
+        if(!first){
+            out_string += " --> ";
+        }
+        out_string += to_string(keys_[position]) + " : " + to_string(values_[position]);
+        position = successor(position);
+        first = false;
+    }
+    return out_string;
+}
+
+void FrozenHybridTable::serialize(ostream& out) const {
+    // magic, sizes, array part, then the list in Eytzinger order as it is in memory
+    writeHeader(out, array_.size(), listSize());
+    out.write((const char*)array_.data(), array_.size() * sizeof(int));
+    writeList(out);
+}
+
+bool FrozenHybridTable::deserialize(istream& in) {
+    *this = FrozenHybridTable();
+
+    char magic[sizeof(FROZEN_MAGIC)];
+    unsigned long long array_size = 0, list_size = 0;
+    in.read(magic, sizeof(magic));
+    in.read((char*)&array_size, sizeof(array_size));
+    in.read((char*)&list_size, sizeof(list_size));
+    if(!in || (memcmp(magic, FROZEN_MAGIC, sizeof(magic)) != 0) || (array_size > (unsigned long long)INT_MAX) || (list_size > (unsigned long long)INT_MAX)){
+        return false;
+    }
+
+    FrozenHybridTable loaded;
+    if(!readInts(in, loaded.array_, array_size) || !readInts(in, loaded.keys_, list_size) || !readInts(in, loaded.values_, list_size)){
+        return false;
+    }
+    if(!loaded.hasValidList()){
+        return false;
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
+
+void FrozenHybridTable::writeHeader(ostream& out, size_t array_size, size_t list_size) {
+    unsigned long long sizes[2] = {array_size, list_size};
+    out.write(FROZEN_MAGIC, sizeof(FROZEN_MAGIC));
+    out.write((const char*)sizes, sizeof(sizes));
+}
+
+void FrozenHybridTable::writeList(ostream& out) const {
+    out.write((const char*)(keys_.data() + 1), listSize() * sizeof(int));
+    out.write((const char*)(values_.data() + 1), listSize() * sizeof(int));
+}
+
+bool FrozenHybridTable::hasValidList() const {
+    // in order, the keys must increase and stay clear of the array part
+    const size_t list_size = listSize();
+    if(list_size == 0){
+        return true;
+    }
+    size_t position = 1;
+    while(2 * position <= list_size){
+        position = 2 * position;
+    }
+    long long previous = LLONG_MIN;
+    for(; position != 0; position = successor(position)){
+        int key = keys_[position];
+        if((key <= previous) || ((key >= 0) && (key < (int)array_.size()))){
+            return false;
+        }
+        previous = key;
+    }
+    return true;
+}
+
+size_t FrozenHybridTable::lowerBound(int i) const {
+    const size_t list_size = listSize();
+    const int* keys = keys_.data();
+
+    // go right while the key is smaller, left otherwise; no branch on the comparison
+    size_t position = 1;
+    while(position <= list_size){
+        __builtin_prefetch(keys + min(16 * position, list_size));   // the level 4 steps down starts here (clamped to keys_)
+        position = 2 * position + (keys[position] < i);
+    }
+
+    // the lower bound is where the walk last went left: drop the trailing right turns and that left turn
+    return position >> __builtin_ffsll(~position);
+}
+
+size_t FrozenHybridTable::successor(size_t position) const {
+    const size_t list_size = listSize();
+    if(2 * position + 1 <= list_size){
+        // leftmost node of the right subtree
+        position = 2 * position + 1;
+        while(2 * position <= list_size){
+            position = 2 * position;
+        }
+        return position;
+    }
+    // climb while coming from a right child, then one more step up
+    return position >> __builtin_ffsll(~position);
+}
+
+size_t FrozenHybridTable::fillEytzinger(const int* indices, const int* values, size_t sorted_position, size_t position) {
+    // in order walk of the implicit tree hands out the sorted entries in order
+    if(position <= listSize()){
+        sorted_position = fillEytzinger(indices, values, sorted_position, 2 * position);
+        keys_[position] = indices[sorted_position];
+        values_[position] = values[sorted_position];
+        sorted_position++;
+        sorted_position = fillEytzinger(indices, values, sorted_position, 2 * position + 1);
+    }
+    return sorted_position;
+}
@@ -0,0 +1,115 @@
+#ifndef FROZENHYBRIDTABLE_H_
+#define FROZENHYBRIDTABLE_H_
+
+#include <climits>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// An immutable, read optimised copy of a HybridTable, made by
+// HybridTable::freeze(). The array part is kept as is; the list part
+// becomes two parallel arrays, with the indices in Eytzinger (breadth
+// first) order so a lookup walks down an implicit binary tree whose top
+// levels share a few cache lines. The search is branch free and
+// prefetches the level four steps ahead.
+class FrozenHybridTable {
+
+public:
+	// Constructs an empty FrozenHybridTable (no array part, no list part).
+	FrozenHybridTable();
+
+	// Constructs from an array part of size n and count list entries,
+	// given as indices and values sorted by index with no repeats.
+	FrozenHybridTable(const int* arr, int n, const int* indices, const int* values, size_t count);
+
+	// Returns the value corresponding to index i, or 0 if not present.
+	int get(int i) const;
+
+	// out[k] = get(indices[k]) for k in [0..count-1].
+	void getMany(const int* indices, int* out, size_t count) const;
+
+	// Calls f(index, val) for every entry with lo <= index < hi, in
+	// increasing index order (array slots included).
+	template<typename F>
+	void forEachInRange(int lo, int hi, F f) const {
+		// list entries before the array part, the array slice, then the rest
+		size_t position = lowerBound(lo);
+		while((position != 0) && (keys_[position] < hi) && (keys_[position] < 0)){
+			f(keys_[position], values_[position]);
+			position = successor(position);
+		}
+		int array_lo = lo > 0 ? lo : 0;
+		int array_hi = hi < getArraySize() ? hi : getArraySize();
+		for(int index = array_lo; index < array_hi; index++){
+			f(index, array_[index]);
+		}
+		while((position != 0) && (keys_[position] < hi)){
+			f(keys_[position], values_[position]);
+			position = successor(position);
+		}
+	}
+
+	// Calls f(index, val) for every entry, in increasing index order.
+	template<typename F>
+	void forEach(F f) const {
+		size_t position = lowerBound(INT_MIN);
+		while((position != 0) && (keys_[position] < 0)){
+			f(keys_[position], values_[position]);
+			position = successor(position);
+		}
+		for(int index = 0; index < getArraySize(); index++){
+			f(index, array_[index]);
+		}
+		while(position != 0){
+			f(keys_[position], values_[position]);
+			position = successor(position);
+		}
+	}
+
+	// Same as HybridTable::getArraySize() of the table it was frozen from.
+	int getArraySize() const;
+
+	// Same as HybridTable::getTotalSize() of the table it was frozen from.
+	int getTotalSize() const;
+
+	// Same as HybridTable::toString() of the table it was frozen from.
+	std::string toString() const;
+
+	// Writes a binary image (host byte order) that deserialize() reads back.
+	void serialize(std::ostream& out) const;
+
+	// Replaces the contents with an image written by serialize().
+	// Returns false, leaving the table empty, if the image is not valid:
+	// truncated, or with list indices out of order or inside the array part.
+	bool deserialize(std::istream& in);
+
+private:
+
+	friend class HybridTableSnapshot; // streams the array part itself, around writeHeader() and writeList()
+
+	std::vector<int> array_;  // array part
+	std::vector<int> keys_;   // list indices in Eytzinger order, 1 based (keys_[0] unused)
+	std::vector<int> values_; // values matching keys_
+
+	// returns the number of list entries
+	size_t listSize() const { return keys_.size() - 1; }
+
+	// returns true if the list indices are in Eytzinger order and outside the array part
+	bool hasValidList() const;
+
+	// returns the Eytzinger position of the first list index >= i, or 0 if there is none
+	size_t lowerBound(int i) const;
+
+	// returns the position that follows position in index order, or 0 at the end
+	size_t successor(size_t position) const;
+
+	// lays out sorted indices/values in Eytzinger order, returns the next sorted position
+	size_t fillEytzinger(const int* indices, const int* values, size_t sorted_position, size_t position);
+
+	// serialize() is writeHeader(), the array part, then writeList()
+	static void writeHeader(std::ostream& out, size_t array_size, size_t list_size);
+	void writeList(std::ostream& out) const;
+};
+
+#endif /* FROZENHYBRIDTABLE_H_ */
@@ -0,0 +1,110 @@
+#include "HybridMatrix.h"
+#include "ArrayKernels.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+
+HybridMatrix::HybridMatrix() {
+
+}
+
+HybridMatrix::HybridMatrix(const HybridTable* rows, int row_count, int cols) {
+    cols_ = std::max(cols, 0);
+    rows_.resize(std::max(row_count, 0));
+
+    // sizes first, so the arena is allocated once
+    vector<HybridTableColumns> columns(rows_.size());
+    size_t arena_size = 0;
+    for(size_t r = 0; r < rows_.size(); r++){
+        columns[r] = rows[r].exportColumns();
+        auto first = lower_bound(columns[r].list_indices.begin(), columns[r].list_indices.end(), 0);
+        auto last = lower_bound(columns[r].list_indices.begin(), columns[r].list_indices.end(), cols_);
+        rows_[r].offset = arena_size;
+        rows_[r].dense_size = (int)std::min(columns[r].array_values.size(), (size_t)cols_);
+        rows_[r].list_size = (int)(last - first);
+        arena_size += rows_[r].dense_size + 2 * (size_t)rows_[r].list_size;
+    }
+
+    arena_.resize(arena_size);
+    for(size_t r = 0; r < rows_.size(); r++){
+        int* out = arena_.data() + rows_[r].offset;
+        out = copy(columns[r].array_values.begin(), columns[r].array_values.begin() + rows_[r].dense_size, out);
+        size_t first = lower_bound(columns[r].list_indices.begin(), columns[r].list_indices.end(), 0) - columns[r].list_indices.begin();
+        out = copy(columns[r].list_indices.begin() + first, columns[r].list_indices.begin() + first + rows_[r].list_size, out);
+        copy(columns[r].list_values.begin() + first, columns[r].list_values.begin() + first + rows_[r].list_size, out);
+    }
+}
+
+int HybridMatrix::get(int row, int col) const {
+    if((row < 0) || (row >= (int)rows_.size()) || (col < 0) || (col >= cols_)){
+        return 0;
+    }
+    const Row& layout = rows_[row];
+    const int* dense = arena_.data() + layout.offset;
+    if(col < layout.dense_size){
+        return dense[col];
+    }
+    const int* list_columns = dense + layout.dense_size;
+    const int* found = lower_bound(list_columns, list_columns + layout.list_size, col);
+    if((found != list_columns + layout.list_size) && (*found == col)){
+        return list_columns[layout.list_size + (found - list_columns)];
+    }
+    return 0;
+}
+
+int HybridMatrix::getRowCount() const {
+    return (int)rows_.size();
+}
+
+int HybridMatrix::getColumnCount() const {
+    return cols_;
+}
+
+int HybridMatrix::getDenseSize(int row) const {
+    if((row < 0) || (row >= (int)rows_.size())){
+        return 0;
+    }
+    return rows_[row].dense_size;
+}
+
+int HybridMatrix::getListSize(int row) const {
+    if((row < 0) || (row >= (int)rows_.size())){
+        return 0;
+    }
+    return rows_[row].list_size;
+}
+
+void HybridMatrix::multiply(const double* x, double* y, ThreadPool* pool) const {
+    int parts = (pool != nullptr) ? pool->size() : 1;
+    if(arena_.size() < (size_t)HybridTable::PARALLEL_BLOCK_SIZE){
+        parts = 1;  // not worth waking the threads
+    }
+    if(parts == 1){
+        multiplyRows(x, y, 0, (int)rows_.size());
+        return;
+    }
+
+    // cut the rows where the arena crosses a multiple of its size / parts,
+    // so dense rows and sparse rows cost alike
+    vector<int> bounds(parts + 1, (int)rows_.size());
+    bounds[0] = 0;
+    int next_bound = 1;
+    for(int r = 0; (r < (int)rows_.size()) && (next_bound < parts); r++){
+        while((next_bound < parts) && (rows_[r].offset >= arena_.size() * next_bound / parts)){
+            bounds[next_bound++] = r;
+        }
+    }
+    pool->run(parts, [&](int part){
+        multiplyRows(x, y, bounds[part], bounds[part + 1]);
+    });
+}
+
+void HybridMatrix::multiplyRows(const double* x, double* y, int first, int last) const {
+    for(int r = first; r < last; r++){
+        const Row& layout = rows_[r];
+        const int* dense = arena_.data() + layout.offset;
+        const int* list_columns = dense + layout.dense_size;
+        y[r] = dotInts(dense, x, layout.dense_size) + gatherDotInts(list_columns, list_columns + layout.list_size, x, layout.list_size);
+    }
+}
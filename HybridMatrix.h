@@ -0,0 +1,70 @@
+#ifndef HYBRIDMATRIX_H_
+#define HYBRIDMATRIX_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "HybridTable.h"
+
+class ThreadPool;
+
+// An immutable int matrix whose rows keep the HybridTable layout: row r
+// holds the array part of the table it was built from as a dense run of
+// columns [0..getDenseSize(r)-1], and its list part as (column, value)
+// pairs in increasing column order, like a row of a CSR matrix. All rows
+// live in one contiguous arena, each as its dense values followed by its
+// list columns and list values, so a row is read front to back.
+// multiply() works through the dense part with vector multiply-adds and
+// gathers x for the list part.
+class HybridMatrix {
+
+public:
+	// Constructs an empty 0 x 0 matrix.
+	HybridMatrix();
+
+	// Constructs a row_count x cols matrix whose row r is rows[r].
+	// Entries of a row at indices outside [0, cols) are left out.
+	HybridMatrix(const HybridTable* rows, int row_count, int cols);
+
+	// Returns the entry at (row, col), or 0 if row or col is out of range.
+	int get(int row, int col) const;
+
+	// Returns the number of rows.
+	int getRowCount() const;
+
+	// Returns the number of columns.
+	int getColumnCount() const;
+
+	// Returns the number of dense columns of row, that is the size of the
+	// array part it was built from (at most getColumnCount()), or 0 if row
+	// is out of range.
+	int getDenseSize(int row) const;
+
+	// Returns the number of list entries stored for row, or 0 if row is
+	// out of range.
+	int getListSize(int row) const;
+
+	// y[r] = the sum over all columns c of get(r, c) * x[c], for every row
+	// r. x must have getColumnCount() entries and y getRowCount(). With a
+	// pool the rows are cut into pieces of about the same number of
+	// stored entries, one per thread.
+	void multiply(const double* x, double* y, ThreadPool* pool = nullptr) const;
+
+private:
+
+    // where a row sits in arena_
+    struct Row {
+        size_t offset;    // first dense value
+        int dense_size;   // dense values, then list_size columns, then list_size values
+        int list_size;
+    };
+
+    int cols_ = 0;
+    std::vector<Row> rows_;
+    std::vector<int> arena_;
+
+    // computes y for rows [first, last)
+    void multiplyRows(const double* x, double* y, int first, int last) const;
+};
+
+#endif /* HYBRIDMATRIX_H_ */
@@ -1,8 +1,83 @@
 #include "HybridTable.h"
-#include "cmath"
+#include "ArrayKernels.h"
+#include "FrozenHybridTable.h"
+#include "HybridTableJournal.h"
+#include "HybridTableSnapshot.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
 
 using namespace std;
 
+// Compact list encoding helpers
+
+// maps signed values to unsigned so small negatives stay small (0,-1,1,-2 -> 0,1,2,3)
+static unsigned int zigzagEncode(int val) {
+    return ((unsigned int)val << 1) ^ (unsigned int)(val >> 31);
+}
+
+static int zigzagDecode(unsigned int val) {
+    return (int)(val >> 1) ^ -(int)(val & 1);
+}
+
+// appends val using 7 bits per byte, high bit set on all but the last byte
+template<typename Bytes>
+static void appendVarint(Bytes& out, unsigned int val) {
+    while(val >= 0x80){
+        out.push_back((unsigned char)(val | 0x80));
+        val >>= 7;
+    }
+    out.push_back((unsigned char)val);
+}
+
+// readVarint for bytes from outside: returns false instead of reading past the end
+template<typename Bytes>
+static bool readVarintChecked(const Bytes& in, size_t& pos, unsigned int& val) {
+    val = 0;
+    for(int shift = 0; (shift < 35) && (pos < in.size()); shift += 7){
+        unsigned char byte = in[pos++];
+        val |= (unsigned int)(byte & 0x7f) << shift;
+        if(!(byte & 0x80)){
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename Bytes>
+static unsigned int readVarint(const Bytes& in, size_t& pos) {
+    unsigned int val = 0;
+    int shift = 0;
+    while(in[pos] & 0x80){
+        val |= (unsigned int)(in[pos] & 0x7f) << shift;
+        shift += 7;
+        pos++;
+    }
+    val |= (unsigned int)in[pos] << shift;
+    pos++;
+    return val;
+}
+
+// approximate malloc header and rounding cost of one heap block of the given size
+static size_t heapBlockOverhead(size_t size) {
+    const size_t alignment = 2 * sizeof(void*);
+    size_t block = (size + sizeof(size_t) + alignment - 1) / alignment * alignment;
+    return block - size;
+}
+
+// policy of a table that never had setPolicy() called
+static const HybridTablePolicy DEFAULT_POLICY;
+
+// heap bytes behind a vector, including the malloc header
+template<typename Vector>
+static size_t vectorHeapBytes(const Vector& vec) {
+    size_t bytes = vec.capacity() * sizeof(typename Vector::value_type);
+    return (bytes == 0) ? 0 : bytes + heapBlockOverhead(bytes);
+}
+
 Node::Node(int index, int val) {
     index_ = index;
     val_ = val;
@@ -19,24 +94,38 @@ Node::~Node() {
 
 }
 
-HybridTable::HybridTable() {
+HybridTable::HybridTable() : HybridTable(pmr::get_default_resource()) {
+}
+
+HybridTable::HybridTable(pmr::memory_resource* resource) : resource_(resource) {
     total_array_size = INITIAL_ARRAY_SIZE;
-    array_ = new int[total_array_size] {0};   // Initializes array_ with all values as 0
+    array_ = allocateArray(total_array_size, array_alignment_);
+    for(int itr=0; itr < total_array_size; itr++){
+        array_[itr] = 0;    // Initializes array_ with all values as 0
+    }
     list_ = nullptr;
 }
 
-HybridTable::HybridTable(const int* p, int n) {
+HybridTable::HybridTable(const int* p, int n) : HybridTable(p, n, pmr::get_default_resource()) {
+}
+
+HybridTable::HybridTable(const int* p, int n, pmr::memory_resource* resource) : resource_(resource) {
     createAndCopyArray(p, n);
     list_ = nullptr;
 }
 
 HybridTable::~HybridTable() {
-    delete [] array_;
+    finishSnapshot();
+    freeArray(array_, total_array_size, array_alignment_);
     deleteAllNodes();
 }
 
-HybridTable::HybridTable(const HybridTable& other) {
-    // Copy new values
+HybridTable::HybridTable(const HybridTable& other) : HybridTable(other, pmr::get_default_resource()) {
+}
+
+HybridTable::HybridTable(const HybridTable& other, pmr::memory_resource* resource) : resource_(resource) {
+    // Copy new values (the optional parts first, so the array part is allocated with the same policy)
+    copyOptionalParts(other);
     createAndCopyArray(other.array_, other.total_array_size);
     list_ = nullptr;
     copyWholeList(other.list_);
@@ -46,10 +135,13 @@ HybridTable& HybridTable::operator=(const HybridTable& other) {
 	if(this != &other){ //To make sure the object is assigning to itself (ex: x=x)
 
         //delete previous values
-        delete [] array_;
+        beforeArrayChange();
+        freeArray(array_, total_array_size, array_alignment_);
         deleteAllNodes();
 
         //copy new values
+        saved_scan_.array_size = -1;
+        copyOptionalParts(other);
         createAndCopyArray(other.array_, other.total_array_size);
         list_ = nullptr;
         copyWholeList(other.list_);
@@ -63,6 +155,22 @@ int HybridTable::get(int i) const {
         return array_[i];
     }
 
+    // most misses stop here, without touching the list
+    if(hasListFilter() && !listFilterMayContain(i)){
+        return 0;
+    }
+
+    if(isCompact()){
+        CompactCursor cursor;
+        int index, val;
+        while(readCompactEntry(cursor, index, val) && (index <= i)){
+            if(index == i){
+                return val;
+            }
+        }
+        return 0;
+    }
+
     Node* node = getNode(i);
     if(node != nullptr){
         return node->val_;
@@ -72,17 +180,185 @@ int HybridTable::get(int i) const {
 }
 
 void HybridTable::set(int i, int val) {
+    if((optional_ != nullptr) && (optional_->journal != nullptr)){
+        optional_->journal->append(i, val);
+    }
+
     if(findAndReplace(i, val)){
         return;
     }
 
     // introduce the new value into the list and then check for the resizing of array
-    insertNodeAtIndex(i, val);
+    Node* inserted = insertNodeAtIndex(i, val);
 
-    int new_array_size = calcNewArraySize();
+    int new_array_size = calcNewArraySize(inserted);
     if(new_array_size > total_array_size){
         resizeArray(new_array_size);
     }
+    else{
+        // the list has a new entry (a resize rebuilds everything anyway)
+        if(hasPrefixIndex()){
+            rebuildListPrefixIndex();
+        }
+        if(hasListFilter()){
+            addToListFilter(i);
+        }
+    }
+}
+
+HybridTable::Hint HybridTable::set(const Hint& hint, int i, int val) {
+    // only trust the hint if no node was freed since it was handed out
+    Node* hint_node = hint.node_;
+    if((hint.table_ == this) && (hint.epoch_ == list_epoch_) && (hint_node != nullptr)){
+        finger_.store(hint_node, memory_order_relaxed);
+    }
+
+    set(i, val);
+
+    Hint next_hint;
+    next_hint.table_ = this;
+    next_hint.node_ = finger_.load(memory_order_relaxed);
+    next_hint.epoch_ = list_epoch_;
+    return next_hint;
+}
+
+bool HybridTable::operator==(const HybridTable& other) const {
+    int overlap = std::min(total_array_size, other.total_array_size);
+    if(firstDifferentInt(array_, other.array_, overlap) != overlap){
+        return false;
+    }
+
+    vector<pair<int, int>> entries, other_entries;
+    appendEntriesOutside(overlap, entries);
+    other.appendEntriesOutside(overlap, other_entries);
+    return entries == other_entries;
+}
+
+uint64_t HybridTable::hash() const {
+    uint64_t total = hashInts(array_, total_array_size, 0);
+    forEachListEntry([&](int index, int val){
+        total += hashEntry(index, val);
+    });
+    return total;
+}
+
+vector<unsigned char> HybridTable::diff(const HybridTable& from, const HybridTable& to) {
+    // changes inside both array parts, skipping equal runs with the vectorised compare
+    int overlap = std::min(from.total_array_size, to.total_array_size);
+    vector<pair<int, int>> array_changes;
+    int itr = firstDifferentInt(from.array_, to.array_, overlap);
+    while(itr < overlap){
+        array_changes.push_back(make_pair(itr, to.array_[itr]));
+        itr++;
+        itr += firstDifferentInt(from.array_ + itr, to.array_ + itr, overlap - itr);
+    }
+
+    // changes outside them, from one ordered walk over both
+    vector<pair<int, int>> from_entries, to_entries, outside_changes;
+    from.appendEntriesOutside(overlap, from_entries);
+    to.appendEntriesOutside(overlap, to_entries);
+    size_t from_itr = 0, to_itr = 0;
+    while((from_itr < from_entries.size()) || (to_itr < to_entries.size())){
+        if((to_itr == to_entries.size()) || ((from_itr < from_entries.size()) && (from_entries[from_itr].first < to_entries[to_itr].first))){
+            outside_changes.push_back(make_pair(from_entries[from_itr++].first, 0));
+        }
+        else if((from_itr == from_entries.size()) || (to_entries[to_itr].first < from_entries[from_itr].first)){
+            outside_changes.push_back(to_entries[to_itr++]);
+        }
+        else{
+            if(from_entries[from_itr].second != to_entries[to_itr].second){
+                outside_changes.push_back(to_entries[to_itr]);
+            }
+            from_itr++;
+            to_itr++;
+        }
+    }
+
+    // count, then the entries in index order like the compact list: negative
+    // outside changes, the array changes, then the rest of the outside changes
+    vector<unsigned char> delta;
+    appendVarint(delta, (unsigned int)(array_changes.size() + outside_changes.size()));
+    vector<pair<int, int>>::const_iterator split = lower_bound(outside_changes.begin(), outside_changes.end(), make_pair(0, INT_MIN));
+    bool first = true;
+    int prev_index = 0;
+    auto appendChange = [&](const pair<int, int>& change){
+        if(first){
+            appendVarint(delta, zigzagEncode(change.first));
+        }
+        else{
+            appendVarint(delta, (unsigned int)change.first - (unsigned int)prev_index - 1u);
+        }
+        appendVarint(delta, zigzagEncode(change.second));
+        prev_index = change.first;
+        first = false;
+    };
+    for_each(outside_changes.cbegin(), split, appendChange);
+    for_each(array_changes.cbegin(), array_changes.cend(), appendChange);
+    for_each(split, outside_changes.cend(), appendChange);
+    return delta;
+}
+
+bool HybridTable::applyPatch(const vector<unsigned char>& delta) {
+    // decode everything first, so a bad delta changes nothing
+    size_t pos = 0;
+    unsigned int count;
+    if(!readVarintChecked(delta, pos, count) || (count > delta.size())){
+        return false;
+    }
+    vector<pair<int, int>> changes;
+    changes.reserve(count);
+    long long prev_index = 0;
+    for(unsigned int itr = 0; itr < count; itr++){
+        unsigned int index_code, val_code;
+        if(!readVarintChecked(delta, pos, index_code) || !readVarintChecked(delta, pos, val_code)){
+            return false;
+        }
+        long long index = (itr == 0) ? zigzagDecode(index_code) : prev_index + index_code + 1;
+        if(index > INT_MAX){
+            return false;
+        }
+        changes.push_back(make_pair((int)index, zigzagDecode(val_code)));
+        prev_index = index;
+    }
+    if(pos != delta.size()){
+        return false;
+    }
+
+    // the presence bitmap keeps the patch's unset array slots from overwriting anything
+    HybridTable patch;
+    patch.enablePresenceBitmap();
+    patch.bulkLoad(changes.data(), changes.size());
+    merge(patch, MergeCombiner::OVERWRITE);
+    return true;
+}
+
+int HybridTable::add(int i, int delta) {
+    return (int)((unsigned int)fetchAdd(i, delta) + (unsigned int)delta);
+}
+
+int HybridTable::fetchAdd(int i, int delta) {
+    return updateValue(i, [delta](int current, int& next){
+        next = (int)((unsigned int)current + (unsigned int)delta);
+        return true;
+    });
+}
+
+int HybridTable::exchange(int i, int val) {
+    return updateValue(i, [val](int, int& next){
+        next = val;
+        return true;
+    });
+}
+
+bool HybridTable::compareExchange(int i, int& expected, int desired) {
+    bool matched = false;
+    int current = updateValue(i, [&](int current_val, int& next){
+        matched = (current_val == expected);
+        next = desired;
+        return matched;
+    });
+    expected = current;
+    return matched;
 }
 
 string HybridTable::toString() const {
@@ -94,13 +370,588 @@ string HybridTable::toString() const {
             out_string += "\n";
         }
     }
-    if(list_ != nullptr){
+    if((list_ != nullptr) || isCompact()){
         out_string = out_string + "\n---\n" + listAsString();
     }
 
 	return out_string;
 }
 
+// parses "index : val" at p, returning the position past it or nullptr
+static const char* parseEntry(const char* p, const char* end, int& index, int& val) {
+    p = parseInt(p, end, index);
+    if((p == nullptr) || (end - p < 3) || (memcmp(p, " : ", 3) != 0)){
+        return nullptr;
+    }
+    return parseInt(p + 3, end, val);
+}
+
+bool HybridTable::fromString(string_view text) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    vector<int> array_values;
+    HybridTableColumns columns;
+
+    // the array part: "i : v" lines with i counting up from 0, and no newline after the last one.
+    // The length of i is known up front, so the value is scanned without waiting for the
+    // index, which is only checked; that halves the chain of dependent loads per line.
+    bool list_follows = (end - p >= 5) && (memcmp(p, "\n---\n", 5) == 0);   // an empty array part
+    long long index_digits = 1;
+    long long next_digit_at = 10;
+    while((p < end) && !list_follows){
+        long long line = (long long)array_values.size();
+        if(line == next_digit_at){
+            index_digits++;
+            next_digit_at *= 10;
+        }
+        int index, val;
+        const char* value_start = p + index_digits + 3;
+        if((end - p < index_digits + 3) || (parseInt(p, end, index) != value_start - 3) || (index != line)
+           || (memcmp(value_start - 3, " : ", 3) != 0)){
+            return false;
+        }
+        p = parseInt(value_start, end, val);
+        if(p == nullptr){
+            return false;
+        }
+        array_values.push_back(val);
+        if(p == end){
+            break;
+        }
+        list_follows = (end - p >= 5) && (memcmp(p, "\n---\n", 5) == 0);
+        if(!list_follows && ((*p != '\n') || (++p == end))){
+            return false;
+        }
+    }
+
+    // the list part: "i : v" entries joined by " --> "
+    if(list_follows){
+        p += 5;
+        while(true){
+            int index, val;
+            p = parseEntry(p, end, index, val);
+            if(p == nullptr){
+                return false;
+            }
+            columns.list_indices.push_back(index);
+            columns.list_values.push_back(val);
+            if(p == end){
+                break;
+            }
+            if((end - p < 5) || (memcmp(p, " --> ", 5) != 0)){
+                return false;
+            }
+            p += 5;
+        }
+    }
+
+    columns.array_values = span<const int>(array_values.data(), array_values.size());
+    return importColumns(columns);
+}
+
+long long HybridTable::sum(int lo, int hi) const {
+    long long total = 0;
+    int slice_lo, slice_hi;
+    if(arraySlice(lo, hi, slice_lo, slice_hi)){
+        total += sumInts(array_ + slice_lo, slice_hi - slice_lo);
+    }
+    forEachListEntryInRange(lo, hi, [&](int, int val){
+        total += val;
+    });
+    return total;
+}
+
+int HybridTable::min(int lo, int hi) const {
+    if(hi <= lo){
+        return 0;
+    }
+
+    long long list_slots = (long long)hi - lo;   // indices of the range outside the array part
+    bool found = false;
+    int result = 0;
+    int slice_lo, slice_hi;
+    if(arraySlice(lo, hi, slice_lo, slice_hi)){
+        result = minInts(array_ + slice_lo, slice_hi - slice_lo);
+        list_slots -= slice_hi - slice_lo;
+        found = true;
+    }
+    forEachListEntryInRange(lo, hi, [&](int, int val){
+        result = (!found || val < result) ? val : result;
+        list_slots--;
+        found = true;
+    });
+
+    // indices without an entry are 0 as far as get() is concerned
+    if(list_slots > 0){
+        result = std::min(result, 0);
+    }
+    return result;
+}
+
+int HybridTable::max(int lo, int hi) const {
+    if(hi <= lo){
+        return 0;
+    }
+
+    long long list_slots = (long long)hi - lo;   // indices of the range outside the array part
+    bool found = false;
+    int result = 0;
+    int slice_lo, slice_hi;
+    if(arraySlice(lo, hi, slice_lo, slice_hi)){
+        result = maxInts(array_ + slice_lo, slice_hi - slice_lo);
+        list_slots -= slice_hi - slice_lo;
+        found = true;
+    }
+    forEachListEntryInRange(lo, hi, [&](int, int val){
+        result = (!found || val > result) ? val : result;
+        list_slots--;
+        found = true;
+    });
+
+    // indices without an entry are 0 as far as get() is concerned
+    if(list_slots > 0){
+        result = std::max(result, 0);
+    }
+    return result;
+}
+
+int HybridTable::countNonZero(int lo, int hi) const {
+    int count = 0;
+    int slice_lo, slice_hi;
+    if(arraySlice(lo, hi, slice_lo, slice_hi)){
+        count += countNonZeroInts(array_ + slice_lo, slice_hi - slice_lo);
+    }
+    forEachListEntryInRange(lo, hi, [&](int, int val){
+        count += (val != 0);
+    });
+    return count;
+}
+
+void HybridTable::enablePrefixIndex() {
+    if(hasPrefixIndex()){
+        return;
+    }
+    optionalParts().prefix_enabled = true;
+    rebuildArrayPrefixIndex();
+    rebuildListPrefixIndex();
+}
+
+void HybridTable::enableListFilter(int bits_per_entry) {
+    OptionalParts& parts = optionalParts();
+    parts.filter_enabled = true;
+    parts.filter_bits_per_entry = std::min(std::max(bits_per_entry, 4), 64);
+    rebuildListFilter();
+}
+
+bool HybridTable::hasListFilter() const {
+    return (optional_ != nullptr) && optional_->filter_enabled;
+}
+
+void HybridTable::attachJournal(HybridTableJournal* journal) {
+    optionalParts().journal = journal;
+}
+
+bool HybridTable::startSnapshot(ostream& out) {
+    OptionalParts& parts = optionalParts();
+    if(parts.snapshot != nullptr){
+        if(!parts.snapshot->isDone()){
+            return false;
+        }
+        parts.snapshot.reset();
+    }
+
+    vector<pair<int, int>> list;
+    forEachListEntry([&](int index, int val){
+        list.push_back(pair<int, int>(index, val));
+    });
+    parts.snapshot.reset(new HybridTableSnapshot(array_, total_array_size, list, out));
+    return true;
+}
+
+bool HybridTable::isSnapshotRunning() const {
+    return (optional_ != nullptr) && (optional_->snapshot != nullptr) && !optional_->snapshot->isDone();
+}
+
+bool HybridTable::finishSnapshot() {
+    if((optional_ == nullptr) || (optional_->snapshot == nullptr)){
+        return true;
+    }
+    bool ok = optional_->snapshot->wait();
+    optional_->snapshot.reset();
+    return ok;
+}
+
+FrozenHybridTable HybridTable::freeze() const {
+    // the list is already sorted by index
+    vector<int> indices, values;
+    forEachListEntry([&](int index, int val){
+        indices.push_back(index);
+        values.push_back(val);
+    });
+    return FrozenHybridTable(array_, total_array_size, indices.data(), values.data(), indices.size());
+}
+
+bool HybridTable::hasPrefixIndex() const {
+    return (optional_ != nullptr) && optional_->prefix_enabled;
+}
+
+long long HybridTable::prefixSum(int i) const {
+    if(!hasPrefixIndex()){
+        return sum(INT_MIN, i);
+    }
+
+    // list entries below i are the first ones in sorted order
+    const vector<int>& list_indices = optional_->prefix_list_indices;
+    int list_count = (int)(lower_bound(list_indices.begin(), list_indices.end(), i) - list_indices.begin());
+    long long total = fenwickPrefix(optional_->prefix_list_tree, list_count);
+    if(i > 0){
+        total += fenwickPrefix(optional_->prefix_array_tree, std::min(i, total_array_size));
+    }
+    return total;
+}
+
+long long HybridTable::rangeSum(int lo, int hi) const {
+    if(hi <= lo){
+        return 0;
+    }
+    if(!hasPrefixIndex()){
+        return sum(lo, hi);
+    }
+    return prefixSum(hi) - prefixSum(lo);
+}
+
+void HybridTable::merge(const HybridTable& other, MergeCombiner combiner, ThreadPool* pool) {
+    if(this == &other){
+        HybridTable copy(other);
+        merge(copy, combiner, pool);
+        return;
+    }
+    beforeArrayChange();
+
+    expandCompactList();
+
+    vector<pair<int, int>> other_list;
+    other_list.reserve(other.getListLength());
+    other.forEachListEntry([&](int index, int val){
+        other_list.push_back(make_pair(index, val));
+    });
+
+    // pick the final array size first: start from the larger array part and
+    // scan the union of both lists outside of it, in order, like calcNewArraySize
+    int start_size = std::max(total_array_size, other.total_array_size);
+    long long used_size = hasPresenceBitmap() ? getArrayLiveSize() + (start_size - total_array_size) : start_size;
+    const HybridTablePolicy& policy = getPolicy();
+    GrowthScan scan = startGrowthScan(policy, start_size, used_size);
+    Node* current_node = list_;
+    size_t other_itr = 0;
+    while((current_node != nullptr) || (other_itr < other_list.size())){
+        int index;
+        if((other_itr == other_list.size()) || ((current_node != nullptr) && (current_node->index_ < other_list[other_itr].first))){
+            index = current_node->index_;
+            current_node = current_node->next_;
+        }
+        else{
+            index = other_list[other_itr].first;
+            if((current_node != nullptr) && (current_node->index_ == index)){
+                current_node = current_node->next_;
+            }
+            other_itr++;
+        }
+        if((index < 0) || (index >= start_size)){
+            scanIndex(policy, scan, index);
+        }
+    }
+    if(scan.out_size > total_array_size){
+        resizeArray(scan.out_size);
+    }
+
+    // array part against array part, vectorised unless a presence bitmap says some slots are unset
+    // (with a pool, each thread takes blocks of PARALLEL_BLOCK_SIZE slots)
+    if(!hasPresenceBitmap() && !other.hasPresenceBitmap()){
+        int blocks = (other.total_array_size + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE;
+        if((pool != nullptr) && (blocks > 1)){
+            pool->run(blocks, [&](int block){
+                int block_lo = block * PARALLEL_BLOCK_SIZE;
+                int block_hi = std::min(block_lo + PARALLEL_BLOCK_SIZE, other.total_array_size);
+                combineArrays(array_ + block_lo, other.array_ + block_lo, block_hi - block_lo, combiner);
+            });
+        }
+        else{
+            combineArrays(array_, other.array_, other.total_array_size, combiner);
+        }
+    }
+    else{
+        other.forEach([&](int index, int val){
+            if((index >= 0) && (index < other.total_array_size)){
+                mergeIntoArray(index, val, combiner);
+            }
+        });
+    }
+
+    // other's list: into the array where it now fits, otherwise one pass along our list
+    Node* previous_node = nullptr;
+    current_node = list_;
+    for(const pair<int, int>& entry : other_list){
+        if((entry.first >= 0) && (entry.first < total_array_size)){
+            mergeIntoArray(entry.first, entry.second, combiner);
+            continue;
+        }
+        while((current_node != nullptr) && (current_node->index_ < entry.first)){
+            previous_node = current_node;
+            current_node = current_node->next_;
+        }
+        if((current_node != nullptr) && (current_node->index_ == entry.first)){
+            current_node->val_ = combineValues(current_node->val_, entry.second, combiner);
+        }
+        else if(previous_node == nullptr){
+            insertHead(entry.first, entry.second);
+            previous_node = list_;
+        }
+        else{
+            insertNodeAfter(previous_node, entry.first, entry.second);
+            previous_node = previous_node->next_;
+        }
+    }
+
+    rebuildOptionalIndexes();
+}
+
+void HybridTable::bulkLoad(const pair<int, int>* entries, size_t count, ThreadPool* pool) {
+    int parts = (pool != nullptr) ? pool->size() : 1;
+    if(count < (size_t)PARALLEL_BLOCK_SIZE){
+        parts = 1;  // not worth waking the threads
+    }
+    size_t chunk = (count + parts - 1) / parts;
+    auto runParts = [&](const function<void(int)>& task){
+        if(parts > 1){
+            pool->run(parts, task);
+        }
+        else{
+            task(0);
+        }
+    };
+
+    // 1. index range of the input, so it can be cut into parts of equal width
+    vector<int> part_min(parts, INT_MAX), part_max(parts, INT_MIN);
+    runParts([&](int part){
+        for(size_t itr = part * chunk; itr < std::min(count, (part + 1) * chunk); itr++){
+            part_min[part] = std::min(part_min[part], entries[itr].first);
+            part_max[part] = std::max(part_max[part], entries[itr].first);
+        }
+    });
+    long long lowest = *min_element(part_min.begin(), part_min.end());
+    long long highest = *max_element(part_max.begin(), part_max.end());
+    long long width = (count == 0) ? 1 : (highest - lowest) / parts + 1;
+    auto partOf = [&](int index){ return (int)((index - lowest) / width); };
+
+    // 2. scatter the input into one bucket per index range; each part of the input
+    // writes its own slice of every bucket, so the input order is kept inside a bucket
+    vector<size_t> offsets((size_t)parts * parts, 0);   // [input part][bucket], counts first
+    runParts([&](int part){
+        for(size_t itr = part * chunk; itr < std::min(count, (part + 1) * chunk); itr++){
+            offsets[(size_t)part * parts + partOf(entries[itr].first)]++;
+        }
+    });
+    vector<size_t> bucket_start(parts + 1, 0);
+    size_t total = 0;
+    for(int bucket = 0; bucket < parts; bucket++){
+        bucket_start[bucket] = total;
+        for(int part = 0; part < parts; part++){
+            size_t part_count = offsets[(size_t)part * parts + bucket];
+            offsets[(size_t)part * parts + bucket] = total;
+            total += part_count;
+        }
+    }
+    bucket_start[parts] = total;
+    vector<pair<int, int>> sorted(count);
+    runParts([&](int part){
+        size_t* next = &offsets[(size_t)part * parts];
+        for(size_t itr = part * chunk; itr < std::min(count, (part + 1) * chunk); itr++){
+            sorted[next[partOf(entries[itr].first)]++] = entries[itr];
+        }
+    });
+
+    // 3. sort every bucket and keep the last value of repeated indices
+    vector<size_t> bucket_end(parts);
+    runParts([&](int bucket){
+        auto first = sorted.begin() + bucket_start[bucket];
+        auto last = sorted.begin() + bucket_start[bucket + 1];
+        stable_sort(first, last, [](const pair<int, int>& a, const pair<int, int>& b){ return a.first < b.first; });
+        auto out = first;
+        for(auto itr = first; itr != last; ++itr){
+            if((itr + 1 != last) && ((itr + 1)->first == itr->first)){
+                continue;
+            }
+            *out++ = *itr;
+        }
+        bucket_end[bucket] = out - sorted.begin();
+    });
+
+    // 4. array size with the resize rule, as if the entries went into a new table
+    beforeArrayChange();
+    clearContents();
+    long long used_size = INITIAL_ARRAY_SIZE;
+    if(hasPresenceBitmap()){
+        used_size = 0;
+        for(int bucket = 0; bucket < parts; bucket++){
+            for(size_t itr = bucket_start[bucket]; itr < bucket_end[bucket]; itr++){
+                used_size += (sorted[itr].first >= 0) && (sorted[itr].first < INITIAL_ARRAY_SIZE);
+            }
+        }
+    }
+    const HybridTablePolicy& policy = getPolicy();
+    GrowthScan scan = startGrowthScan(policy, INITIAL_ARRAY_SIZE, used_size);
+    for(int bucket = 0; bucket < parts; bucket++){
+        for(size_t itr = bucket_start[bucket]; itr < bucket_end[bucket]; itr++){
+            if((sorted[itr].first < 0) || (sorted[itr].first >= INITIAL_ARRAY_SIZE)){
+                scanIndex(policy, scan, sorted[itr].first);
+            }
+        }
+    }
+    int array_size = scan.out_size;
+    freeArray(array_, total_array_size, array_alignment_);
+    total_array_size = array_size;
+    array_alignment_ = arrayAlignment(array_size);
+    array_ = allocateArray(array_size, array_alignment_);
+    if(hasPresenceBitmap()){
+        optional_->presence.assign(((size_t)array_size + 63) / 64, 0);
+    }
+
+    // 5. every bucket fills its part of the array and chains up its own nodes; memory
+    // resources need not be thread safe, so the node memory is taken from resource_ up front
+    vector<size_t> node_start(parts + 1, 0);
+    runParts([&](int bucket){
+        size_t list_count = 0;
+        for(size_t itr = bucket_start[bucket]; itr < bucket_end[bucket]; itr++){
+            list_count += (sorted[itr].first < 0) || (sorted[itr].first >= array_size);
+        }
+        node_start[bucket + 1] = list_count;
+    });
+    for(int bucket = 0; bucket < parts; bucket++){
+        node_start[bucket + 1] += node_start[bucket];
+    }
+    vector<void*> node_memory(node_start[parts]);
+    for(void*& memory : node_memory){
+        memory = resource_->allocate(sizeof(Node), alignof(Node));
+    }
+    vector<Node*> heads(parts, nullptr), tails(parts, nullptr);
+    runParts([&](int part){
+        fill(array_ + (long long)array_size * part / parts, array_ + (long long)array_size * (part + 1) / parts, 0);
+    });
+    runParts([&](int bucket){
+        size_t next_memory = node_start[bucket];
+        for(size_t itr = bucket_start[bucket]; itr < bucket_end[bucket]; itr++){
+            int index = sorted[itr].first;
+            if((index >= 0) && (index < array_size)){
+                array_[index] = sorted[itr].second;
+                continue;
+            }
+            // not allocateNode: the inline node slots are not safe to hand out from several threads
+            Node* new_node = new (node_memory[next_memory++]) Node(index, sorted[itr].second);
+            if(tails[bucket] == nullptr){
+                heads[bucket] = new_node;
+            }
+            else{
+                tails[bucket]->next_ = new_node;
+            }
+            tails[bucket] = new_node;
+        }
+    });
+
+    // 6. splice the chains in bucket order, which is index order
+    Node* tail = nullptr;
+    for(int bucket = 0; bucket < parts; bucket++){
+        if(heads[bucket] == nullptr){
+            continue;
+        }
+        if(tail == nullptr){
+            list_ = heads[bucket];
+        }
+        else{
+            tail->next_ = heads[bucket];
+        }
+        tail = tails[bucket];
+    }
+
+    if(hasPresenceBitmap()){
+        for(int bucket = 0; bucket < parts; bucket++){
+            for(size_t itr = bucket_start[bucket]; itr < bucket_end[bucket]; itr++){
+                if((sorted[itr].first >= 0) && (sorted[itr].first < array_size)){
+                    markPresent(sorted[itr].first);
+                }
+            }
+        }
+    }
+    rebuildOptionalIndexes();
+}
+
+HybridTableColumns HybridTable::exportColumns() const {
+    HybridTableColumns columns;
+    columns.array_values = span<const int>(array_, total_array_size);
+    int list_length = getListLength();
+    columns.list_indices.reserve(list_length);
+    columns.list_values.reserve(list_length);
+    forEachListEntry([&](int index, int val){
+        columns.list_indices.push_back(index);
+        columns.list_values.push_back(val);
+    });
+    return columns;
+}
+
+bool HybridTable::importColumns(const HybridTableColumns& columns) {
+    size_t list_length = columns.list_indices.size();
+    if((columns.list_values.size() != list_length) || (columns.array_values.size() > (size_t)INT_MAX)){
+        return false;
+    }
+    int array_size = (int)columns.array_values.size();
+    for(size_t itr = 0; itr < list_length; itr++){
+        int index = columns.list_indices[itr];
+        if(((index >= 0) && (index < array_size)) || ((itr > 0) && (index <= columns.list_indices[itr - 1]))){
+            return false;
+        }
+    }
+
+    // the new array part is filled before the old one is freed, as the columns
+    // may have been exported from this very table
+    beforeArrayChange();
+    clearContents();
+    size_t alignment = arrayAlignment(array_size);
+    int* new_array = allocateArray(array_size, alignment);
+    if(array_size > 0){
+        memmove(new_array, columns.array_values.data(), (size_t)array_size * sizeof(int));
+    }
+    freeArray(array_, total_array_size, array_alignment_);
+    array_ = new_array;
+    array_alignment_ = alignment;
+    total_array_size = array_size;
+    if(hasPresenceBitmap()){
+        optional_->presence_enabled = false;
+        enablePresenceBitmap();
+    }
+
+    Node* tail = nullptr;
+    for(size_t itr = 0; itr < list_length; itr++){
+        Node* new_node = allocateNode(columns.list_indices[itr], columns.list_values[itr], nullptr);
+        if(tail == nullptr){
+            list_ = new_node;
+        }
+        else{
+            tail->next_ = new_node;
+        }
+        tail = new_node;
+    }
+    rebuildOptionalIndexes();
+    return true;
+}
+
+void HybridTable::importColumns(const int* indices, const int* values, size_t count, ThreadPool* pool) {
+    vector<pair<int, int>> entries(count);
+    for(size_t itr = 0; itr < count; itr++){
+        entries[itr] = make_pair(indices[itr], values[itr]);
+    }
+    bulkLoad(entries.data(), count, pool);
+}
+
 int HybridTable::getArraySize() const {
 	return total_array_size;
 }
@@ -109,15 +960,166 @@ int HybridTable::getTotalSize() const {
     return total_array_size + getListLength();
 }
 
+HybridTableMemoryUsage HybridTable::memoryUsage() const {
+    HybridTableMemoryUsage usage;
+    usage.array_bytes = total_array_size * sizeof(int);
+    usage.overhead_bytes = sizeof(HybridTable);
+
+    // the inline buffers are part of sizeof(HybridTable), so whatever they hold
+    // is moved out of the overhead and only heap blocks pay a malloc header
+    if(array_ == inline_array_){
+        usage.overhead_bytes -= usage.array_bytes;
+    }
+    else{
+        usage.overhead_bytes += heapBlockOverhead(usage.array_bytes);
+    }
+
+    if(isCompact()){
+        usage.sparse_bytes = optional_->compact_list.capacity();
+        usage.overhead_bytes += heapBlockOverhead(usage.sparse_bytes);
+    }
+    else{
+        size_t list_length = getListLength();
+        size_t inline_nodes = 0;
+        for(int itr=0; itr < INLINE_NODE_COUNT; itr++){
+            inline_nodes += (inline_nodes_used_ >> itr) & 1u;
+        }
+        usage.sparse_bytes = list_length * sizeof(Node);
+        usage.overhead_bytes -= inline_nodes * sizeof(Node);
+        usage.overhead_bytes += (list_length - inline_nodes) * heapBlockOverhead(sizeof(Node));
+    }
+
+    // the optional indexes, in their own heap block
+    if(optional_ != nullptr){
+        usage.overhead_bytes += sizeof(OptionalParts) + heapBlockOverhead(sizeof(OptionalParts));
+        usage.overhead_bytes += vectorHeapBytes(optional_->presence);
+        usage.overhead_bytes += vectorHeapBytes(optional_->prefix_array_tree);
+        usage.overhead_bytes += vectorHeapBytes(optional_->prefix_list_indices);
+        usage.overhead_bytes += vectorHeapBytes(optional_->prefix_list_tree);
+        usage.overhead_bytes += vectorHeapBytes(optional_->filter_words);
+    }
+
+    return usage;
+}
+
+pmr::memory_resource* HybridTable::getResource() const {
+    return resource_;
+}
+
+void HybridTable::compact() {
+    if(list_ == nullptr){
+        return;
+    }
+
+    pmr::vector<unsigned char> encoded(resource_);
+    int length = 0;
+    int prev_index = 0;
+    for(Node* current_node = list_; current_node != nullptr; current_node = current_node->next_){
+        // first index is stored as is, the rest as the gap to the previous index minus one
+        // (the list is sorted and has no duplicates, so consecutive indices cost a single 0 byte)
+        if(length == 0){
+            appendVarint(encoded, zigzagEncode(current_node->index_));
+        }
+        else{
+            appendVarint(encoded, (unsigned int)current_node->index_ - (unsigned int)prev_index - 1u);
+        }
+        appendVarint(encoded, zigzagEncode(current_node->val_));
+        prev_index = current_node->index_;
+        length++;
+    }
+    encoded.shrink_to_fit();
+
+    deleteAllNodes();
+    OptionalParts& parts = optionalParts();
+    parts.compact_list.swap(encoded);
+    parts.compact_length = length;
+}
+
+bool HybridTable::isCompact() const {
+    return (optional_ != nullptr) && !optional_->compact_list.empty();
+}
+
+void HybridTable::setPolicy(const HybridTablePolicy& policy) {
+    saved_scan_.array_size = -1;
+    OptionalParts& parts = optionalParts();
+    HybridTablePolicy& new_policy = parts.policy;
+    new_policy = policy;
+
+    // keep the policy usable: between 1% and 100% density,
+    // at least doubling and never more than 2^30 slots
+    new_policy.density_percent = std::min(std::max(new_policy.density_percent, 1), 100);
+    new_policy.growth_shift = std::min(std::max(new_policy.growth_shift, 1), 30);
+    new_policy.max_array_size = std::min(std::max(new_policy.max_array_size, 0), 1 << 30);
+
+    // alignments are powers of 2 up to a huge page
+    size_t alignment = 1;
+    while((alignment < (size_t)new_policy.array_alignment) && (alignment < HUGE_PAGE_SIZE)){
+        alignment <<= 1;
+    }
+    new_policy.array_alignment = (new_policy.array_alignment <= 0) ? 0 : (int)alignment;
+
+    // move an array part that is not allocated the new way yet
+    if((array_ != inline_array_) && (arrayAlignment(total_array_size) != array_alignment_)){
+        resizeArray(total_array_size);
+    }
+}
+
+const HybridTablePolicy& HybridTable::getPolicy() const {
+    return (optional_ != nullptr) ? optional_->policy : DEFAULT_POLICY;
+}
+
+void HybridTable::enablePresenceBitmap() {
+    if(hasPresenceBitmap()){
+        return;
+    }
+    OptionalParts& parts = optionalParts();
+    parts.presence_enabled = true;
+
+    // a slot that was set to 0 can't be told apart from one never set, so only non zero slots count
+    parts.presence.assign(((size_t)total_array_size + 63) / 64, 0);
+    for(int itr=0; itr < total_array_size; itr++){
+        if(array_[itr] != 0){
+            markPresent(itr);
+        }
+    }
+}
+
+bool HybridTable::hasPresenceBitmap() const {
+    return (optional_ != nullptr) && optional_->presence_enabled;
+}
+
+int HybridTable::getLiveSize() const {
+    return getArrayLiveSize() + getListLength();
+}
+
 bool HybridTable::findAndReplace(const int index, const int val) {
     if((index < total_array_size) & (index >= 0)){  // checks if the index is between 0 and total array size
+        if(hasPrefixIndex()){
+            updatePrefixIndex(index, (long long)val - array_[index]);
+        }
+        if((optional_ != nullptr) && (optional_->snapshot != nullptr)){
+            optional_->snapshot->beforeArrayWrite(index);
+        }
         array_[index] = val;
+        markPresent(index);
         return true;
     }
 
+    // the list part has to be made of nodes before it can be modified, even
+    // when the filter then rules out a search, as set() inserts right after
+    expandCompactList();
+
+    // a new index can skip the list search when the filter rules it out
+    if(hasListFilter() && !listFilterMayContain(index)){
+        return false;
+    }
+
     // checks if the node is available and changes
     Node* node = getNode(index);
     if(node != nullptr){
+        if(hasPrefixIndex()){
+            updatePrefixIndex(index, (long long)val - node->val_);
+        }
         node->val_ = val;
         return true;
     }
@@ -125,84 +1127,434 @@ bool HybridTable::findAndReplace(const int index, const int val) {
     return false;
 }
 
-int HybridTable::calcNewArraySize() {
-    int out_size = total_array_size;
-    int used_size = total_array_size;
-    int next_size = nextPossibleArraySize(out_size);
+int HybridTable::calcNewArraySize(const Node* inserted) {
+    // every slot counts as used, unless the presence bitmap knows better
+    int live_size = getArrayLiveSize();
+    const HybridTablePolicy& policy = getPolicy();
+
+    // an append right after the saved scan only adds the new, largest index to it
+    // (saved_scan_.tail may only be read while no node was freed since)
+    SavedGrowthScan& saved = saved_scan_;
+    if((saved.array_size == total_array_size) && (saved.live_size == live_size) && (saved.epoch == list_epoch_)){
+        bool appended = (inserted->next_ == nullptr)
+                        && ((saved.tail == nullptr) ? (list_ == inserted) : (saved.tail->next_ == inserted));
+        if(appended){
+            scanIndex(policy, saved.scan, inserted->index_);
+            saved.tail = inserted;
+            return saved.scan.out_size;
+        }
+    }
+
+    GrowthScan scan = startGrowthScan(policy, total_array_size, live_size);
+    Node* last_node = nullptr;
+    for(Node* current_node = list_; current_node != nullptr; current_node = current_node->next_){
+        scanIndex(policy, scan, current_node->index_);
+        last_node = current_node;
+    }
 
-    Node* current_node = list_;
-    while(current_node != nullptr){
-        int current_node_index = current_node->index_;
+    // save where the scan ended for the next append
+    saved.scan = scan;
+    saved.tail = last_node;
+    saved.epoch = list_epoch_;
+    saved.array_size = total_array_size;
+    saved.live_size = live_size;
+    return scan.out_size;
+}
 
-        // increment used size if the current index is valid in new size
-        if((current_node_index < next_size) && (current_node_index >= 0)){
-            used_size ++;
-        }
+HybridTable::GrowthScan HybridTable::startGrowthScan(const HybridTablePolicy& policy, int size, long long used_size) {
+    GrowthScan scan;
+    scan.out_size = size;
+    scan.used_size = used_size;
+    scan.next_size = nextPossibleArraySize(policy, size);
+    return scan;
+}
 
-        // if the used size percent is greater than or equal to 75 change out_size to new_size
-        if(calcPercent(used_size, next_size) >= 75.0f){
-            out_size = next_size;
-        }
+void HybridTable::scanIndex(const HybridTablePolicy& policy, GrowthScan& scan, int index) {
+    // increment used size if the current index is valid in new size
+    if((index < scan.next_size) && (index >= 0)){
+        scan.used_size ++;
+    }
 
-        if(current_node_index >= next_size){
-            next_size = nextPossibleArraySize(next_size);
-            used_size++;
-        }
-        current_node = current_node->next_;
+    // if the used size share reaches the density threshold change out_size to new_size
+    if((scan.used_size * 100 >= scan.next_size * policy.density_percent) && (scan.next_size <= policy.max_array_size)){
+        scan.out_size = (int)scan.next_size;
     }
 
-    return out_size;
+    if(index >= scan.next_size){
+        scan.next_size = nextPossibleArraySize(policy, scan.next_size);
+        scan.used_size++;
+    }
 }
 
-int HybridTable::nextPossibleArraySize(int size) {
-    int current_power = ceil(sqrt(size));
-    if(pow(2, current_power) <= size){
-        current_power += 1;
+long long HybridTable::nextPossibleArraySize(const HybridTablePolicy& policy, long long size) {
+    // smallest power of 2 greater than size, found from the highest set bit
+    long long next_size = 1;
+    if(size > 0){
+        next_size = 1LL << (64 - __builtin_clzll((unsigned long long)size));
     }
 
-    return pow(2, current_power);
+    // scale that by 2^(growth_shift-1), so a power of 2 size grows by a factor
+    // of 2^growth_shift: 4, 8, 16, 32 for shift 1 and 4, 16, 64, 256 for shift 2
+    return next_size << (policy.growth_shift - 1);
 }
 
 void HybridTable::resizeArray(int size) {
+    beforeArrayChange();
     int old_size = total_array_size;
     total_array_size = size;
 
-    int* temp_array = new int[total_array_size]{0}; // create an array with new size
-    for(int itr=0; itr<old_size; itr++){
-        temp_array[itr] = array_[itr];  // copy values from previous array
+    // the array only moves if it outgrows the inline buffer (or already lives on the heap)
+    if((array_ != inline_array_) || (total_array_size > INITIAL_ARRAY_SIZE)){
+        size_t alignment = arrayAlignment(total_array_size);
+        int* temp_array = allocateArray(total_array_size, alignment); // create an array with new size
+        for(int itr=0; itr<old_size; itr++){
+            temp_array[itr] = array_[itr];  // copy values from previous array
+        }
+        freeArray(array_, old_size, array_alignment_);
+        array_ = temp_array;
+        array_alignment_ = alignment;
+    }
+    for(int itr=old_size; itr<total_array_size; itr++){
+        array_[itr] = 0;
+    }
+    if(hasPresenceBitmap()){
+        optional_->presence.resize(((size_t)total_array_size + 63) / 64, 0);   // new slots start as never set
     }
-    delete [] array_;
-    array_ = temp_array;
-
 
+    // unlink as we go, so moving k nodes costs O(k) rather than a findPreviousNode each
+    Node* previous_node = nullptr;
     Node* current_node = list_;
     while(current_node != nullptr){
         Node* next_node = current_node->next_;
         int current_node_index = current_node->index_;
 
-        if(current_node_index > size){
+        if(current_node_index >= size){
             break;
         }
 
         // if the list index is a valid new array index copy the value to array and remove it from the list
-        if((current_node_index < size) && (current_node_index >= 0)){
+        if(current_node_index >= 0){
             array_[current_node_index] = current_node->val_;
-            removeNode(current_node);
+            markPresent(current_node_index);
+            if(previous_node == nullptr){
+                list_ = next_node;
+            }
+            else{
+                previous_node->next_ = next_node;
+            }
+            freeNode(current_node);
+        }
+        else{
+            previous_node = current_node;
         }
 
         current_node = next_node;
     }
 
+    rebuildOptionalIndexes();
+
 }
 
 void HybridTable::createAndCopyArray(const int* otherArray, int otherArraySize) {
     total_array_size = otherArraySize;
-    array_ = new int[total_array_size]; // initialize a new array with the other array size
+    array_alignment_ = arrayAlignment(total_array_size);
+    array_ = allocateArray(total_array_size, array_alignment_); // initialize a new array with the other array size
     for (int itr = 0; itr < total_array_size; itr++) {
         array_[itr] = otherArray[itr]; //copy the values of other array
     }
 }
 
+void HybridTable::copyOptionalParts(const HybridTable& other) {
+    if((optional_ == nullptr) && (other.optional_ == nullptr)){
+        return;
+    }
+
+    // the journal and the snapshot belong to this table and stay
+    const OptionalParts none(resource_);
+    const OptionalParts& from = (other.optional_ != nullptr) ? *other.optional_ : none;
+    OptionalParts& to = optionalParts();
+    to.policy = from.policy;
+    to.presence_enabled = from.presence_enabled;
+    to.presence = from.presence;
+    to.prefix_enabled = from.prefix_enabled;
+    to.prefix_array_tree = from.prefix_array_tree;
+    to.prefix_list_indices = from.prefix_list_indices;
+    to.prefix_list_tree = from.prefix_list_tree;
+    to.filter_enabled = from.filter_enabled;
+    to.filter_bits_per_entry = from.filter_bits_per_entry;
+    to.filter_entries = from.filter_entries;
+    to.filter_words = from.filter_words;
+    to.compact_list = from.compact_list;
+    to.compact_length = from.compact_length;
+}
+
+void HybridTable::rebuildOptionalIndexes() {
+    saved_scan_.array_size = -1;   // the list or the array part changed wholesale
+    if(hasPrefixIndex()){
+        rebuildArrayPrefixIndex();
+        rebuildListPrefixIndex();
+    }
+    if(hasListFilter()){
+        rebuildListFilter();
+    }
+}
+
+void HybridTable::rebuildListFilter() {
+    // room for twice the current list, so it takes a while before the next rebuild
+    size_t capacity = std::max(2 * (size_t)getListLength(), (size_t)64);
+    OptionalParts& parts = *optional_;
+    parts.filter_words.assign((capacity * parts.filter_bits_per_entry + 63) / 64, 0);
+    parts.filter_entries = 0;
+    forEachListEntry([&](int index, int){
+        uint64_t hash = filterHash(index);
+        parts.filter_words[filterWordFor(hash)] |= filterMaskFor(hash);
+        parts.filter_entries++;
+    });
+}
+
+void HybridTable::addToListFilter(int index) {
+    OptionalParts& parts = *optional_;
+    if(parts.filter_entries >= parts.filter_words.size() * 64 / parts.filter_bits_per_entry){
+        rebuildListFilter();    // full, the false positive rate would start climbing
+        return;
+    }
+    uint64_t hash = filterHash(index);
+    parts.filter_words[filterWordFor(hash)] |= filterMaskFor(hash);
+    parts.filter_entries++;
+}
+
+bool HybridTable::listFilterMayContain(int index) const {
+    uint64_t hash = filterHash(index);
+    uint64_t mask = filterMaskFor(hash);
+    return (optional_->filter_words[filterWordFor(hash)] & mask) == mask;
+}
+
+uint64_t HybridTable::filterHash(int index) {
+    // splitmix64 finaliser
+    uint64_t hash = (uint64_t)(unsigned int)index + 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+size_t HybridTable::filterWordFor(uint64_t hash) const {
+    // high half of the hash picks the word (multiply and shift instead of a modulo)
+    return (size_t)(((hash >> 32) * optional_->filter_words.size()) >> 32);
+}
+
+uint64_t HybridTable::filterMaskFor(uint64_t hash) {
+    // three bits inside the one word, from the low 18 bits of the hash
+    return ((uint64_t)1 << (hash & 63)) | ((uint64_t)1 << ((hash >> 6) & 63)) | ((uint64_t)1 << ((hash >> 12) & 63));
+}
+
+void HybridTable::rebuildArrayPrefixIndex() {
+    // tree[k] holds the sum of the (k & -k) slots ending at slot k-1
+    vector<long long>& tree = optional_->prefix_array_tree;
+    tree.assign(total_array_size + 1, 0);
+    for(int itr=1; itr <= total_array_size; itr++){
+        tree[itr] += array_[itr - 1];
+        int parent = itr + (itr & -itr);
+        if(parent <= total_array_size){
+            tree[parent] += tree[itr];
+        }
+    }
+}
+
+void HybridTable::rebuildListPrefixIndex() {
+    vector<int>& list_indices = optional_->prefix_list_indices;
+    vector<long long>& tree = optional_->prefix_list_tree;
+    list_indices.clear();
+    tree.assign(1, 0);
+    forEachListEntry([&](int index, int val){
+        list_indices.push_back(index);
+        tree.push_back(val);
+    });
+
+    int list_count = (int)list_indices.size();
+    for(int itr=1; itr <= list_count; itr++){
+        int parent = itr + (itr & -itr);
+        if(parent <= list_count){
+            tree[parent] += tree[itr];
+        }
+    }
+}
+
+void HybridTable::updatePrefixIndex(int index, long long delta) {
+    if((index < total_array_size) && (index >= 0)){
+        fenwickAdd(optional_->prefix_array_tree, index + 1, delta);
+        return;
+    }
+    const vector<int>& list_indices = optional_->prefix_list_indices;
+    int position = (int)(lower_bound(list_indices.begin(), list_indices.end(), index) - list_indices.begin());
+    fenwickAdd(optional_->prefix_list_tree, position + 1, delta);
+}
+
+void HybridTable::fenwickAdd(std::vector<long long>& tree, int position, long long delta) {
+    for(; position < (int)tree.size(); position += position & -position){
+        tree[position] += delta;
+    }
+}
+
+long long HybridTable::fenwickPrefix(const std::vector<long long>& tree, int count) {
+    long long total = 0;
+    for(; count > 0; count -= count & -count){
+        total += tree[count];
+    }
+    return total;
+}
+
+void HybridTable::appendEntriesOutside(int size, vector<pair<int, int>>& out) const {
+    // list entries below 0, the array slots from size on, then list entries past the array part
+    forEachListEntryInRange(INT_MIN, 0, [&](int index, int val){
+        if(val != 0){
+            out.push_back(make_pair(index, val));
+        }
+    });
+    for(int itr = size; itr < total_array_size; itr++){
+        if(array_[itr] != 0){
+            out.push_back(make_pair(itr, array_[itr]));
+        }
+    }
+    forEachListEntry([&](int index, int val){
+        if((index >= 0) && (val != 0)){
+            out.push_back(make_pair(index, val));
+        }
+    });
+}
+
+void HybridTable::beforeArrayChange() {
+    if((optional_ != nullptr) && (optional_->snapshot != nullptr)){
+        optional_->snapshot->preserveAll();
+    }
+}
+
+void HybridTable::clearContents() {
+    deleteAllNodes();
+    if(optional_ != nullptr){
+        optional_->compact_list.clear();
+        optional_->compact_list.shrink_to_fit();
+        optional_->compact_length = 0;
+    }
+}
+
+void HybridTable::combineArrays(int* dst, const int* src, int n, MergeCombiner combiner) {
+    switch(combiner){
+    case MergeCombiner::OVERWRITE:
+        copy(src, src + n, dst);
+        break;
+    case MergeCombiner::ADD:
+        addIntsInto(dst, src, n);
+        break;
+    case MergeCombiner::MAX:
+        maxIntsInto(dst, src, n);
+        break;
+    case MergeCombiner::MIN:
+        minIntsInto(dst, src, n);
+        break;
+    }
+}
+
+void HybridTable::mergeIntoArray(int index, int val, MergeCombiner combiner) {
+    // a slot the presence bitmap knows was never set just takes the new value
+    bool present = !hasPresenceBitmap() || (optional_->presence[index >> 6] >> (index & 63) & 1);
+    array_[index] = present ? combineValues(array_[index], val, combiner) : val;
+    markPresent(index);
+}
+
+int HybridTable::combineValues(int current, int val, MergeCombiner combiner) {
+    switch(combiner){
+    case MergeCombiner::ADD:
+        return (int)((unsigned int)current + (unsigned int)val);   // wraps around like the vector version
+    case MergeCombiner::MAX:
+        return std::max(current, val);
+    case MergeCombiner::MIN:
+        return std::min(current, val);
+    case MergeCombiner::OVERWRITE:
+    default:
+        return val;
+    }
+}
+
+HybridTable::OptionalParts::OptionalParts(pmr::memory_resource* resource) : compact_list(resource) {
+}
+
+HybridTable::OptionalParts& HybridTable::optionalParts() {
+    if(optional_ == nullptr){
+        optional_.reset(new OptionalParts(resource_));
+    }
+    return *optional_;
+}
+
+int HybridTable::getArrayLiveSize() const {
+    if(!hasPresenceBitmap()){
+        return total_array_size;
+    }
+
+    int live_size = 0;
+    for(uint64_t word : optional_->presence){
+        live_size += __builtin_popcountll(word);
+    }
+    return live_size;
+}
+
+size_t HybridTable::arrayAlignment(int size) const {
+    size_t bytes = (size_t)size * sizeof(int);
+    const HybridTablePolicy& policy = getPolicy();
+    if((policy.huge_page_bytes != 0) && (bytes >= policy.huge_page_bytes)){
+        return HUGE_PAGE_SIZE;
+    }
+    return std::max((size_t)policy.array_alignment, alignof(int));
+}
+
+int* HybridTable::allocateArray(int size, size_t alignment) {
+    if(size <= INITIAL_ARRAY_SIZE){
+        return inline_array_;
+    }
+    size_t bytes = (size_t)size * sizeof(int);
+    int* array = (int*)resource_->allocate(bytes, alignment);
+#ifdef MADV_HUGEPAGE
+    // only whole huge pages can be backed by one, and the hint is all it is
+    if(alignment >= HUGE_PAGE_SIZE){
+        madvise(array, bytes & ~(HUGE_PAGE_SIZE - 1), MADV_HUGEPAGE);
+    }
+#endif
+    return array;
+}
+
+void HybridTable::freeArray(int* array, int size, size_t alignment) {
+    if(array != inline_array_){
+        resource_->deallocate(array, (size_t)size * sizeof(int), alignment);
+    }
+}
+
+Node* HybridTable::allocateNode(int index, int val, Node* next) {
+    // take the first free inline slot, if there is one
+    for(int itr=0; itr < INLINE_NODE_COUNT; itr++){
+        if(!(inline_nodes_used_ & (1u << itr))){
+            inline_nodes_used_ |= (1u << itr);
+            return new (inline_nodes_ + itr * sizeof(Node)) Node(index, val, next);
+        }
+    }
+    return new (resource_->allocate(sizeof(Node), alignof(Node))) Node(index, val, next);
+}
+
+void HybridTable::freeNode(Node* node) {
+    // the finger and outstanding hints must never point at a freed node
+    if(finger_.load(memory_order_relaxed) == node){
+        finger_.store(nullptr, memory_order_relaxed);
+    }
+    list_epoch_++;
+
+    unsigned char* address = (unsigned char*)node;
+    if((address >= inline_nodes_) && (address < inline_nodes_ + sizeof(inline_nodes_))){
+        node->~Node();
+        inline_nodes_used_ &= ~(1u << ((address - inline_nodes_) / sizeof(Node)));
+        return;
+    }
+    node->~Node();
+    resource_->deallocate(node, sizeof(Node), alignof(Node));
+}
+
 void HybridTable::copyWholeList(Node* otherList) {
     if(otherList == list_){
         return;
@@ -210,12 +1562,12 @@ void HybridTable::copyWholeList(Node* otherList) {
     // first copy the head node and then loop through the remaining nodes
     if(otherList != nullptr){
         Node* other_current = otherList;
-        list_ = new Node(other_current->index_, other_current->val_);
+        list_ = allocateNode(other_current->index_, other_current->val_, nullptr);
         Node* this_current = list_;
         other_current = otherList->next_;
 
         while(other_current != nullptr){
-            Node* temp_node = new Node(other_current->index_, other_current->val_);
+            Node* temp_node = allocateNode(other_current->index_, other_current->val_, nullptr);
             this_current->next_ = temp_node;
             other_current = other_current->next_;
             this_current = temp_node;
@@ -224,6 +1576,10 @@ void HybridTable::copyWholeList(Node* otherList) {
 }
 
 int HybridTable::getListLength() const {
+    if(isCompact()){
+        return optional_->compact_length;
+    }
+
     int list_length = 0;
     Node* current_node = list_;
     while(current_node != nullptr){
@@ -234,40 +1590,58 @@ int HybridTable::getListLength() const {
 }
 
 Node *HybridTable::getNode(int index) const {
-    Node* current_node = list_;
-    while(current_node != nullptr){
+    Node* current_node = listStartFor(index);
+    Node* previous_node = nullptr;
+    while((current_node != nullptr) && (current_node->index_ <= index)){   // sorted, so stop once past index
         if(current_node->index_ == index){
+            finger_.store(current_node, memory_order_relaxed);
             return current_node;
         }
+        previous_node = current_node;
         current_node = current_node->next_;
     }
+
+    // remember where index would go, so a set() that follows can insert there directly
+    if(previous_node != nullptr){
+        finger_.store(previous_node, memory_order_relaxed);
+    }
     return nullptr;
 }
 
+Node* HybridTable::listStartFor(int index) const {
+    Node* finger = finger_.load(memory_order_relaxed);
+    if((finger != nullptr) && (finger->index_ <= index)){
+        return finger;
+    }
+    return list_;
+}
+
 void HybridTable::insertHead(int index, int val) {
-    Node* new_node = new Node(index, val, list_);
+    Node* new_node = allocateNode(index, val, list_);
     list_ = new_node;
+    finger_.store(new_node, memory_order_relaxed);
 }
 
 void HybridTable::insertNodeAfter(Node* location, int index, int val) {
     if(location == nullptr){
         return;
     }
-    Node* new_node = new Node(index, val);
+    Node* new_node = allocateNode(index, val, nullptr);
     if(location->next_ != nullptr){
         new_node->next_ = location->next_;
     }
     location->next_ = new_node;
 }
 
-void HybridTable::insertNodeAtIndex(int index, int val) {
+Node* HybridTable::insertNodeAtIndex(int index, int val) {
     if((list_ == nullptr) || (index < list_->index_)){   // insert into the head node if it null or the current index is less than head
         insertHead(index, val);
-        return;
+        return list_;
     }
 
     // find the possible insert location such that the list should be in increasing order
-    Node* current_node = list_;
+    // (starting from the finger if it is not past index)
+    Node* current_node = listStartFor(index);
     Node* possible_location = current_node;
     while(current_node != nullptr){
         if(current_node->index_ <= index){
@@ -279,6 +1653,8 @@ void HybridTable::insertNodeAtIndex(int index, int val) {
         current_node = current_node->next_;
     }
     insertNodeAfter(possible_location, index, val);
+    finger_.store(possible_location->next_, memory_order_relaxed);
+    return possible_location->next_;
 }
 
 void HybridTable::removeNodeAfter(Node* node) {
@@ -287,7 +1663,7 @@ void HybridTable::removeNodeAfter(Node* node) {
     }
     Node* temp_node = node->next_;
     node->next_ = node->next_->next_;
-    delete temp_node;
+    freeNode(temp_node);
 }
 
 void HybridTable::removeNode(Node* node) {
@@ -311,7 +1687,7 @@ void HybridTable::removeHeadNode() {
     }
 
     Node* temp_node = list_->next_;
-    delete list_;
+    freeNode(list_);
     list_ = temp_node;
 }
 
@@ -334,25 +1710,136 @@ void HybridTable::deleteAllNodes() {
     while(list_ != nullptr){
         Node* temp_node = list_;
         list_ = temp_node->next_;
-        delete temp_node;
+        freeNode(temp_node);
     }
 }
 
 string HybridTable::listAsString() const {
     string out_string;
-    Node* current_head = list_;
     int itr =0;
-    while(current_head != nullptr){
+    forEachListEntry([&](int index, int val){
         if(itr != 0){
             out_string += " --> ";
         }
-        out_string += to_string(current_head->index_) + " : " + to_string(current_head->val_);
-        current_head = current_head->next_;
+        out_string += to_string(index) + " : " + to_string(val);
         itr++;
-    }
+    });
     return out_string;
 }
 
-float HybridTable::calcPercent(const int num1, const int num2) {
-    return (((float)num1 / (float)num2) * 100.0f);
-}
\ No newline at end of file
+template<typename F>
+void HybridTable::forEachListEntryInRange(int lo, int hi, F f) const {
+    if(hi <= lo){
+        return;
+    }
+
+    if(isCompact()){
+        CompactCursor cursor;
+        int index, val;
+        while(readCompactEntry(cursor, index, val) && (index < hi)){
+            if(index >= lo){
+                f(index, val);
+            }
+        }
+        return;
+    }
+
+    // the list is sorted, so stop at the first index past the range
+    for(Node* current_node = list_; (current_node != nullptr) && (current_node->index_ < hi); current_node = current_node->next_){
+        if(current_node->index_ >= lo){
+            f(current_node->index_, current_node->val_);
+        }
+    }
+}
+
+template<typename F>
+int HybridTable::updateValue(int i, F f) {
+    int* slot = nullptr;
+    if((i < total_array_size) && (i >= 0)){
+        slot = &array_[i];
+    }
+    else{
+        expandCompactList();
+        Node* node = (!hasListFilter() || listFilterMayContain(i)) ? getNode(i) : nullptr;
+        if(node != nullptr){
+            slot = &node->val_;
+        }
+    }
+
+    int current = (slot != nullptr) ? *slot : 0;
+    int next = current;
+    if(!f(current, next)){
+        return current;
+    }
+    if(slot == nullptr){
+        set(i, next);   // a new entry, which may resize the array part
+        return current;
+    }
+
+    // same bookkeeping as findAndReplace, without searching again
+    if((optional_ != nullptr) && (optional_->journal != nullptr)){
+        optional_->journal->append(i, next);
+    }
+    if(hasPrefixIndex()){
+        updatePrefixIndex(i, (long long)next - current);
+    }
+    if((i < total_array_size) && (i >= 0)){
+        if((optional_ != nullptr) && (optional_->snapshot != nullptr)){
+            optional_->snapshot->beforeArrayWrite(i);
+        }
+        markPresent(i);
+    }
+    *slot = next;
+    return current;
+}
+
+bool HybridTable::hasPlainArrayWrites() const {
+    return (optional_ == nullptr) || (!optional_->prefix_enabled && !optional_->presence_enabled
+                                      && (optional_->journal == nullptr) && (optional_->snapshot == nullptr));
+}
+
+bool HybridTable::arraySlice(int lo, int hi, int& slice_lo, int& slice_hi) const {
+    slice_lo = std::max(lo, 0);
+    slice_hi = std::min(hi, total_array_size);
+    return slice_lo < slice_hi;
+}
+
+bool HybridTable::readCompactEntry(CompactCursor& cursor, int& index, int& val) const {
+    const pmr::vector<unsigned char>& compact_list = optional_->compact_list;
+    if(cursor.pos >= compact_list.size()){
+        return false;
+    }
+
+    if(cursor.pos == 0){
+        index = zigzagDecode(readVarint(compact_list, cursor.pos));
+    }
+    else{
+        index = (int)((unsigned int)cursor.prev_index + readVarint(compact_list, cursor.pos) + 1u);
+    }
+    val = zigzagDecode(readVarint(compact_list, cursor.pos));
+    cursor.prev_index = index;
+    return true;
+}
+
+void HybridTable::expandCompactList() {
+    if(!isCompact()){
+        return;
+    }
+
+    // decode in order and keep appending at the tail
+    Node* tail = nullptr;
+    forEachListEntry([&](int index, int val){
+        Node* new_node = allocateNode(index, val, nullptr);
+        if(tail == nullptr){
+            list_ = new_node;
+        }
+        else{
+            tail->next_ = new_node;
+        }
+        tail = new_node;
+    });
+
+    optional_->compact_list.clear();
+    optional_->compact_list.shrink_to_fit();
+    optional_->compact_length = 0;
+}
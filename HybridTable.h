@@ -1,9 +1,67 @@
 #ifndef HYBRIDTABLE_H_
 #define HYBRIDTABLE_H_
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 using std::string;
 
+class ThreadPool;
+class FrozenHybridTable;
+class HybridTableJournal;
+class HybridTableSnapshot;
+class ConcurrentHybridTable;
+
+// Memory used by a HybridTable, in bytes
+struct HybridTableMemoryUsage {
+	size_t array_bytes;    // bytes of the array part
+	size_t sparse_bytes;   // bytes of the list part (nodes or compact encoding)
+	size_t overhead_bytes; // the HybridTable object itself, its optional indexes and allocator headers
+
+	// Returns the sum of all three parts.
+	size_t total() const { return array_bytes + sparse_bytes + overhead_bytes; }
+};
+
+// Controls when the array part grows, by how much, and how it is allocated.
+// The defaults give the standard behaviour: the array part grows to the
+// largest power of 2 that would be at least 75% full.
+// Note that a full array part is always 50% of the next power of 2, so a
+// density_percent of 50 or less grows the array part on every new entry.
+struct HybridTablePolicy {
+	int density_percent = 75;     // a candidate array size needs this share (in %) of its slots in use
+	int growth_shift = 1;         // consecutive candidate sizes differ by a factor of 2^growth_shift
+	int max_array_size = 1 << 30; // the array part never grows beyond this many slots
+	int array_alignment = 0;      // the array part starts at a multiple of this many bytes (0 = the resource's default), e.g. 64 for a cache line
+	size_t huge_page_bytes = 0;   // array parts of at least this many bytes are HUGE_PAGE_SIZE aligned and advised as huge pages (0 = never)
+};
+
+// The contents of a HybridTable as columns, made by
+// HybridTable::exportColumns(). The array part is not copied: array_values
+// points into the table and is only valid until the table is next modified
+// or destroyed.
+struct HybridTableColumns {
+	std::span<const int> array_values; // array_values[i] is the value at index i
+	std::vector<int> list_indices;     // list part indices, in increasing order
+	std::vector<int> list_values;      // list_values[k] is the value at list_indices[k]
+};
+
+// How HybridTable::merge combines a value already in the table (current)
+// with the value from the other table (val)
+enum class MergeCombiner {
+	OVERWRITE, // val
+	ADD,       // current + val, wrapping around on overflow
+	MAX,       // the larger of the two
+	MIN        // the smaller of the two
+};
+
 class Node {
 
 	int index_;  // index of this node
@@ -47,9 +105,39 @@ public:
 	// Copy constructor.
 	HybridTable(const HybridTable& other);
 
+	// Same as the three constructors above, but the array part, the
+	// nodes and the compact list are allocated from resource instead of
+	// the default memory resource. resource must outlive the table. A
+	// copy made with the plain copy constructor uses the default
+	// resource, and assignment keeps the resource of the target.
+	explicit HybridTable(std::pmr::memory_resource* resource);
+	HybridTable(const int* arr, int n, std::pmr::memory_resource* resource);
+	HybridTable(const HybridTable& other, std::pmr::memory_resource* resource);
+
 	// Copy assignment operator.
 	HybridTable& operator=(const HybridTable& other);
 
+	// Returns true if get(i) is the same on both tables for every index,
+	// however their entries are split between the array and list parts.
+	// Overlapping array parts are compared with vectorised loops, the
+	// rest in one ordered walk.
+	bool operator==(const HybridTable& other) const;
+
+	// Returns a hash of the contents that equal tables share (entries
+	// holding 0 count as missing). It is a sum over entries, so it does
+	// not depend on how they are split between the two parts.
+	uint64_t hash() const;
+
+	// Returns a compact delta (the indices where get() differs, delta
+	// encoded as varints, with the values of to) such that
+	// from.applyPatch(diff(from, to)) makes from == to. Its size follows
+	// the number of changed indices rather than the table size.
+	static std::vector<unsigned char> diff(const HybridTable& from, const HybridTable& to);
+
+	// Applies a delta made by diff(), merged in like merge(OVERWRITE).
+	// Returns false, leaving the table unchanged, if delta is malformed.
+	bool applyPatch(const std::vector<unsigned char>& delta);
+
 	// Returns the value corresponding to index i.
 	// If index i is not present in the HybridTable, return 0.
 	int get(int i) const;
@@ -58,6 +146,37 @@ public:
 	// Resizing of the array part, if required, should also happen here.
 	void set(int i, int val);
 
+	// A remembered position in the list part, returned by set(hint, i, val).
+	// A default constructed Hint, or one from another table, is ignored.
+	class Hint {
+		const HybridTable* table_ = nullptr;
+		Node* node_ = nullptr;
+		unsigned long epoch_ = 0;  // list_epoch_ when the hint was made
+	friend class HybridTable;
+	};
+
+	// Same as set(i, val), but the list search starts from hint (if it is
+	// still valid and not past i). Pass the returned Hint to the next call,
+	// so runs of increasing or nearby indices cost O(1) each to locate.
+	Hint set(const Hint& hint, int i, int val);
+
+	// Read-modify-write on index i, which is located only once (a missing
+	// index reads as 0 and is inserted like set() would). Additions wrap
+	// around like unsigned ints do.
+
+	// Adds delta to the value at index i and returns the new value.
+	int add(int i, int delta);
+
+	// Adds delta to the value at index i and returns the old value.
+	int fetchAdd(int i, int delta);
+
+	// Sets the value at index i to val and returns the old value.
+	int exchange(int i, int val);
+
+	// If the value at index i equals expected, sets it to desired and
+	// returns true; otherwise stores the value in expected and returns false.
+	bool compareExchange(int i, int& expected, int desired);
+
 	// Returns a string representation of the HybridTable, as described
 	// in the assignment webpage.
 	// Note that it does not actually print anything to the screen.
@@ -65,6 +184,124 @@ public:
 	// white spaces are correct.
 	string toString() const;
 
+	// Replaces the contents with the table text describes, in the format
+	// of toString(), so that fromString(t.toString()) reproduces t
+	// exactly, split between the parts the same way. The numbers are
+	// scanned 8 bytes at a time and the result is built in one pass with
+	// importColumns(). Returns false and changes nothing if text is not
+	// in that format.
+	bool fromString(std::string_view text);
+
+	// Range aggregates over the indices lo <= i < hi, with the same values
+	// get(i) would return (so indices without an entry count as 0).
+	// The covered slice of the array part is handled by vectorised loops
+	// and the list part by one ordered walk that stops at hi.
+	// An empty range (hi <= lo) gives 0 for all of them.
+
+	// Returns the sum of get(i) over the range.
+	long long sum(int lo, int hi) const;
+
+	// Returns the smallest get(i) over the range.
+	int min(int lo, int hi) const;
+
+	// Returns the largest get(i) over the range.
+	int max(int lo, int hi) const;
+
+	// Returns the number of indices in the range where get(i) is not 0.
+	int countNonZero(int lo, int hi) const;
+
+	// Builds a prefix sum index (Fenwick trees over the array part and over
+	// the list part in index order) that set() keeps up to date. Changing
+	// an existing entry costs O(log n) extra; adding a list entry or
+	// resizing rebuilds the affected tree in O(n), the same order as the
+	// list insert itself. With it prefixSum() and rangeSum() are O(log n).
+	void enablePrefixIndex();
+
+	// Returns true if enablePrefixIndex() was called.
+	bool hasPrefixIndex() const;
+
+	// Returns the sum of get(j) over all j < i (including negative j).
+	// Without the prefix index this falls back to a full sum().
+	long long prefixSum(int i) const;
+
+	// Returns the same as sum(lo, hi), from two prefixSum() lookups.
+	long long rangeSum(int lo, int hi) const;
+
+	// Merges every entry of other into this HybridTable. Indices present in
+	// both are combined with combiner, the others are copied over. The final
+	// array part size is worked out once, from the larger of the two array
+	// parts and the union of both lists, using the same rule as set(); then
+	// the array parts are combined with vectorised loops and the lists are
+	// merged in a single pass, so the whole merge is linear.
+	// Unless other has the presence bitmap, every slot of its array part
+	// counts as present, holding 0 if it was never set: merging a plain
+	// table with OVERWRITE, MIN or MAX writes those zeros over this table's
+	// values. Call enablePresenceBitmap() on other before filling it to
+	// merge only the entries that were actually set.
+	// With a pool, the array part is combined by all of its threads.
+	void merge(const HybridTable& other, MergeCombiner combiner, ThreadPool* pool = nullptr);
+
+	// Returns the contents as columns: a view of the array part and
+	// packed copies of the list part (see HybridTableColumns).
+	HybridTableColumns exportColumns() const;
+
+	// Replaces the contents with the given columns, reproducing the table
+	// they were exported from: the array part gets exactly
+	// columns.array_values, and the list part the list columns, without
+	// sorting. Returns false and changes nothing if the list columns differ
+	// in length, are not strictly increasing or have an index inside the
+	// array part. The policy and optional parts are kept.
+	bool importColumns(const HybridTableColumns& columns);
+
+	// Same as bulkLoad() with the entries (indices[k], values[k]) for k
+	// in [0..count-1].
+	void importColumns(const int* indices, const int* values, size_t count, ThreadPool* pool = nullptr);
+
+	// Replaces the contents with count (index, value) entries, in any order;
+	// for repeated indices the last one wins. The array part size is picked
+	// with the same rule as set(), starting from a new table. With a pool,
+	// the entries are split by index range, and each thread sorts its range
+	// and fills its slice of the array part and its own piece of the list,
+	// which are then joined. The policy and optional parts are kept.
+	void bulkLoad(const std::pair<int, int>* entries, size_t count, ThreadPool* pool = nullptr);
+
+	// Builds a membership filter over the list indices (a Bloom filter in
+	// which every index sets three bits of a single 64 bit word), so get()
+	// and set() on an index outside the array part that is not in the list
+	// usually return after one word instead of a full list walk. Inserts
+	// update it; resizes, merges and bulk loads rebuild it. bits_per_entry
+	// trades memory for fewer false positives (8 gives roughly 5%).
+	void enableListFilter(int bits_per_entry = 8);
+
+	// Returns true if enableListFilter() was called.
+	bool hasListFilter() const;
+
+	// Returns an immutable copy laid out for fast lookups (see
+	// FrozenHybridTable.h). The table itself is left unchanged.
+	FrozenHybridTable freeze() const;
+
+	// From now on every set() is also appended to journal (see
+	// HybridTableJournal.h); nullptr stops journaling. The journal must
+	// outlive its use here. Copies and assignments don't take it over.
+	void attachJournal(HybridTableJournal* journal);
+
+	// Starts writing a point in time image of the table to out (in the
+	// FrozenHybridTable::serialize() format) on a background thread and
+	// returns at once; set() keeps working on the table meanwhile. The
+	// list part is copied here, the array part chunk by chunk with copy on
+	// write (see HybridTableSnapshot.h). Resizes, merges, bulk loads and
+	// assignments first copy the chunks not written yet. out must stay
+	// valid until finishSnapshot(). Returns false if the previous snapshot
+	// is still running.
+	bool startSnapshot(std::ostream& out);
+
+	// Returns true while a started snapshot is still being written.
+	bool isSnapshotRunning() const;
+
+	// Waits for the snapshot started last, if any. Returns false if
+	// writing it failed.
+	bool finishSnapshot();
+
 	// Returns the number of entries of the array part. In other words,
 	// the array part indices are [0..getArraySize()-1].
 	int getArraySize() const;
@@ -73,20 +310,176 @@ public:
 	// the list part.
 	int getTotalSize() const;
 
+	// Returns the number of bytes used by this HybridTable, split into
+	// the array part, the list part and bookkeeping overhead (which
+	// includes the presence bitmap, the prefix index and the list filter).
+	HybridTableMemoryUsage memoryUsage() const;
+
+	// Returns the memory resource this table allocates from.
+	std::pmr::memory_resource* getResource() const;
+
+	// Re-encodes the list part into a compact byte stream (delta encoded
+	// indices and zigzag values, both as varints), which costs a few bytes
+	// per entry instead of a heap allocated Node. Meant for cold tables:
+	// get() and toString() work on the encoding directly, and the list is
+	// expanded back into nodes the next time set() needs to modify it.
+	void compact();
+
+	// Returns true if the list part is currently in compact form.
+	bool isCompact() const;
+
+	// Replaces the growth policy. Out of range fields are clamped.
+	// Takes effect the next time set() adds an entry; the current
+	// array part is never shrunk, but it is moved right away if it is
+	// not allocated the way the new policy asks for.
+	void setPolicy(const HybridTablePolicy& policy);
+
+	// Returns the growth policy in use.
+	const HybridTablePolicy& getPolicy() const;
+
+	// Starts tracking which array slots have actually been set, in a bitmap
+	// with one bit per slot. Slots that are non zero at this point count as
+	// set. From then on getLiveSize() and forEach() skip unset slots, and
+	// resizing decisions use the real occupancy of the array part.
+	void enablePresenceBitmap();
+
+	// Returns true if enablePresenceBitmap() was called.
+	bool hasPresenceBitmap() const;
+
+	// Returns the number of entries that were actually set: set array slots
+	// plus list entries. Without the presence bitmap every array slot counts,
+	// so this is the same as getTotalSize().
+	int getLiveSize() const;
+
+	// Calls f(index, val) for every entry, array part first and then the
+	// list part, both in increasing index order. With the presence bitmap
+	// unset array slots are skipped 64 at a time.
+	template<typename F>
+	void forEach(F f) const {
+		if(hasPresenceBitmap()){
+			const std::vector<uint64_t>& presence = optional_->presence;
+			for(size_t word_itr = 0; word_itr < presence.size(); word_itr++){
+				uint64_t word = presence[word_itr];
+				while(word != 0){
+					int index = (int)(word_itr * 64) + __builtin_ctzll(word);
+					f(index, array_[index]);
+					word &= word - 1;   // clear lowest set bit
+				}
+			}
+		}
+		else{
+			for(int index = 0; index < total_array_size; index++){
+				f(index, array_[index]);
+			}
+		}
+		forEachListEntry(f);
+	}
+
 	// We didn't explain what static and constexpr are, but you can just
 	// use them in HybridTable.cpp just like normal constants
 	// DO NOT CHANGE, MOVE OR REMOVE IT
 	static constexpr int INITIAL_ARRAY_SIZE = 4; // default array part size
 
+	// number of list nodes stored inside the HybridTable object itself
+	// before any node has to be allocated on the heap
+	static constexpr int INLINE_NODE_COUNT = 4;
+
+	// array slots (or entries) per task when work is split over a ThreadPool
+	static constexpr int PARALLEL_BLOCK_SIZE = 1 << 16;
+
+	// alignment of array parts that reach HybridTablePolicy::huge_page_bytes
+	// (the size of a transparent huge page on x86-64)
+	static constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
 private:
 
+	friend class ConcurrentHybridTable; // writes array slots with atomic_ref
+	friend class CompressedHybridTable; // shares the growth rule
+
 	int* array_; // pointer to array part
 	Node* list_; // pointer to head of list part
+	std::pmr::memory_resource* resource_; // source of the array part, nodes and compact list
 
 	// add other member variables if required
 
     int total_array_size = 0; // To keep track of current array size
 
+    // Small table storage, so tiny tables never touch the heap.
+    // array_ points to inline_array_ while the array part has at most
+    // INITIAL_ARRAY_SIZE entries, and the first INLINE_NODE_COUNT nodes
+    // are constructed inside inline_nodes_ (bit i of inline_nodes_used_
+    // is set while slot i holds a node).
+    int inline_array_[INITIAL_ARRAY_SIZE];
+    unsigned int inline_nodes_used_ = 0;
+    alignas(Node) unsigned char inline_nodes_[INLINE_NODE_COUNT * sizeof(Node)];
+
+    size_t array_alignment_ = alignof(int); // alignment array_ was allocated with
+
+    // Finger: the node of the last list lookup or insert (or the node just
+    // before a missed index). Searches for an index at or past it start
+    // there instead of at list_. Reset when its node is freed. Atomic so
+    // that concurrent get() calls may each move it.
+    mutable std::atomic<Node*> finger_{nullptr};
+    unsigned long list_epoch_ = 0;  // counts freed nodes, to tell stale hints apart
+
+    // state of the resize rule while it walks over the list indices in order
+    struct GrowthScan {
+        int out_size;         // best array size found so far
+        long long used_size;  // slots that would be used in next_size
+        long long next_size;  // candidate array size being checked
+    };
+
+    // Where the last full calcNewArraySize() scan ended. It is only resumed
+    // while no node was freed (list_epoch_), the array part is unchanged and
+    // the new node comes right after tail; resizes, merges, bulk loads,
+    // imports, copies and setPolicy() drop it. Kept inline (48 bytes) so
+    // that a long list does not need the optional parts.
+    struct SavedGrowthScan {
+        GrowthScan scan;             // state after feeding the list up to tail
+        const Node* tail = nullptr;  // last node fed to scan, nullptr for an empty list
+        unsigned long epoch = 0;     // list_epoch_ when the scan was saved
+        int array_size = -1;         // total_array_size the scan started from, -1 if there is none
+        int live_size = 0;           // getArrayLiveSize() the scan started from
+    };
+    SavedGrowthScan saved_scan_;
+
+    // Everything that most tables never use, allocated the first time one
+    // of its parts is needed, so a plain table only pays for the pointer.
+    struct OptionalParts {
+        explicit OptionalParts(std::pmr::memory_resource* resource); // the compact list allocates from resource
+
+        HybridTablePolicy policy; // growth policy used by calcNewArraySize
+
+        bool presence_enabled = false;  // true once enablePresenceBitmap() was called
+        std::vector<uint64_t> presence; // bit i set if array_[i] was set, one word per 64 slots
+
+        // prefix sum index, only kept up to date once enablePrefixIndex() was called
+        bool prefix_enabled = false;
+        std::vector<long long> prefix_array_tree; // Fenwick tree over array_ (1 based)
+        std::vector<int> prefix_list_indices;     // list indices in sorted order
+        std::vector<long long> prefix_list_tree;  // Fenwick tree over the list values in that order
+
+        // list membership filter, only kept up to date once enableListFilter() was called
+        bool filter_enabled = false;
+        int filter_bits_per_entry = 8;
+        size_t filter_entries = 0;           // indices added since the last rebuild
+        std::vector<uint64_t> filter_words;
+
+        HybridTableJournal* journal = nullptr; // receives every set() once attachJournal() was called
+        std::unique_ptr<HybridTableSnapshot> snapshot; // the snapshot started last, until finishSnapshot()
+
+        std::pmr::vector<unsigned char> compact_list; // list part in compact form, empty unless compact()
+        int compact_length = 0;                      // number of entries in compact_list
+
+    };
+    std::unique_ptr<OptionalParts> optional_;
+
+    // read position into the compact list
+    struct CompactCursor {
+        size_t pos = 0;
+        int prev_index = 0;
+    };
+
 	// add other member functions if required
 
     // Hybrid Table helper functions
@@ -97,23 +490,124 @@ private:
     bool findAndReplace(int index, int val);
 
     // returns a new array size if the array can be expanded
-    // or else returns the current array size
-    int calcNewArraySize();
+    // or else returns the current array size; inserted is the node set()
+    // just added, and if it was appended right after the last scanned node
+    // only its index is fed to the saved scan
+    int calcNewArraySize(const Node* inserted);
+
+    // starts a scan from an array part of the given size with used_size slots in use
+    static GrowthScan startGrowthScan(const HybridTablePolicy& policy, int size, long long used_size);
+
+    // feeds the next list index (in increasing order) to the scan
+    static void scanIndex(const HybridTablePolicy& policy, GrowthScan& scan, int index);
 
-    // calculates the new possible array size int powers of 2
-    int nextPossibleArraySize(int size);
+    // calculates the next candidate array size after size: the next power
+    // of 2, times the policy's growth factor (integer only, may exceed int)
+    static long long nextPossibleArraySize(const HybridTablePolicy& policy, long long size);
 
     // resizes the whole array and the list with the new size
     void resizeArray(int size);
 
+    // marks array_[index] as set in the presence bitmap, if there is one
+    void markPresent(int index) {
+        if(hasPresenceBitmap()){
+            optional_->presence[index >> 6] |= (uint64_t)1 << (index & 63);
+        }
+    }
+
+    // returns optional_, allocating it first if needed
+    OptionalParts& optionalParts();
+
+    // returns the number of set array slots (all of them without the presence bitmap)
+    int getArrayLiveSize() const;
+
+    // appends the entries not 0 with an index outside [0..size-1] (size at most
+    // total_array_size) to out, in index order
+    void appendEntriesOutside(int size, std::vector<std::pair<int, int>>& out) const;
+
+    // lets a running snapshot copy what it still needs before array_ moves or changes in bulk
+    void beforeArrayChange();
+
+    // deletes the list part, in either form, leaving the array part alone
+    void clearContents();
+
+    // combines src[0..n-1] into dst[0..n-1] with the vectorised loops
+    static void combineArrays(int* dst, const int* src, int n, MergeCombiner combiner);
+
+    // combines val into array_[index] for merge
+    void mergeIntoArray(int index, int val, MergeCombiner combiner);
+
+    // returns the merged value of current and val
+    static int combineValues(int current, int val, MergeCombiner combiner);
+
+    // copies everything besides the array and the node list from other
+    // (compact list, policy, presence bitmap, prefix index)
+    void copyOptionalParts(const HybridTable& other);
+
+    // rebuilds the prefix index and the list filter, if enabled
+    void rebuildOptionalIndexes();
+
+    // List filter helper functions
+
+    // sizes the filter for the current list and adds every list index
+    void rebuildListFilter();
+
+    // adds a new list index, rebuilding first if the filter is full
+    void addToListFilter(int index);
+
+    // returns false if index is definitely not in the list
+    bool listFilterMayContain(int index) const;
+
+    // mixes the bits of index
+    static uint64_t filterHash(int index);
+
+    // returns the filter word for an index with this hash
+    size_t filterWordFor(uint64_t hash) const;
+
+    // returns the bits an index with this hash sets in its word
+    static uint64_t filterMaskFor(uint64_t hash);
+
+    // Prefix index helper functions
+
+    // recomputes the Fenwick tree over the array part in O(n)
+    void rebuildArrayPrefixIndex();
+
+    // recomputes the sorted list indices and their Fenwick tree in O(n)
+    void rebuildListPrefixIndex();
+
+    // adds delta to the entry at index, which must already exist
+    void updatePrefixIndex(int index, long long delta);
+
+    // adds delta at the 1 based position of a Fenwick tree
+    static void fenwickAdd(std::vector<long long>& tree, int position, long long delta);
+
+    // returns the sum of the first count positions of a Fenwick tree
+    static long long fenwickPrefix(const std::vector<long long>& tree, int count);
+
     // Array helper functions
 
     // initializes array_ and copies the values of other array_ to this array_
     void createAndCopyArray(const int* otherArray, int otherArraySize);
 
+    // returns the alignment the policy asks for an array part of the given size
+    size_t arrayAlignment(int size) const;
+
+    // returns uninitialised storage for an array part of the given size,
+    // the inline buffer if it fits, else memory from resource_
+    int* allocateArray(int size, size_t alignment);
+
+    // releases storage returned by allocateArray(size, alignment)
+    void freeArray(int* array, int size, size_t alignment);
+
 
     // Linked List Helper Functions
 
+    // creates a node, in a free inline slot if there is one, else in memory from resource_
+    Node* allocateNode(int index, int val, Node* next);
+
+    // destroys a node created by allocateNode
+    void freeNode(Node* node);
+
     // copies the whole list from other hybrid table list
     // Note: do only use to copy values of whole linked list
     void copyWholeList(Node* otherList);
@@ -124,14 +618,18 @@ private:
     // finds a node in the list using index
     Node* getNode(int index) const;
 
+    // returns the node a search for index should start from: the finger if
+    // it is not past index, otherwise the head of the list
+    Node* listStartFor(int index) const;
+
     // inserts a node at the start of the list
     void insertHead(int index, int val);
 
     // inserts node after the given node
     void insertNodeAfter(Node* location, int index, int val);
 
-    // inserts a node into the list using index
-    void insertNodeAtIndex(int index, int val);
+    // inserts a node into the list using index and returns it
+    Node* insertNodeAtIndex(int index, int val);
 
     // deletes node after a given node
     void removeNodeAfter(Node* node);
@@ -151,9 +649,49 @@ private:
     // returns the list part as string
     string listAsString() const;
 
-
-    // General helper function
-    float calcPercent(int num1, int num2);
+    // calls f(index, val) for every list entry in increasing index order,
+    // whether the list part is made of nodes or is in compact form
+    template<typename F>
+    void forEachListEntry(F f) const {
+        if(isCompact()){
+            CompactCursor cursor;
+            int index, val;
+            while(readCompactEntry(cursor, index, val)){
+                f(index, val);
+            }
+            return;
+        }
+        for(Node* current_node = list_; current_node != nullptr; current_node = current_node->next_){
+            f(current_node->index_, current_node->val_);
+        }
+    }
+
+
+    // calls f(index, val) for the list entries with lo <= index < hi, in order
+    template<typename F>
+    void forEachListEntryInRange(int lo, int hi, F f) const;
+
+    // finds the slot of index i once, calls f(current, next) and stores next
+    // there if f returns true (inserting i if it was missing); returns current
+    template<typename F>
+    int updateValue(int i, F f);
+
+    // true if array part writes need no bookkeeping (no prefix index, presence
+    // bitmap, journal or snapshot), so ConcurrentHybridTable may write slots atomically
+    bool hasPlainArrayWrites() const;
+
+    // clips [lo, hi) to the array part, returns false if they don't overlap
+    bool arraySlice(int lo, int hi, int& slice_lo, int& slice_hi) const;
+
+
+    // Compact list helper functions
+
+    // decodes the entry at the cursor and advances it
+    // returns false once the end of the encoding is reached
+    bool readCompactEntry(CompactCursor& cursor, int& index, int& val) const;
+
+    // turns the compact encoding back into a list of nodes
+    void expandCompactList();
 
 };
 
@@ -0,0 +1,525 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CompressedHybridTable.h"
+#include "ConcurrentHybridTable.h"
+#include "FrozenHybridTable.h"
+#include "HybridMatrix.h"
+#include "HybridTable.h"
+#include "HybridTableWriter.h"
+#include "ThreadPool.h"
+#include "VersionedHybridTable.h"
+
+using namespace std;
+
+// Benchmarks for HybridTable. Each benchmark prints one row per configuration
+// so the memory/latency trade-offs can be compared side by side.
+
+static const int BENCH_ENTRIES = 1 << 12;
+
+struct Workload {
+	string name;
+	vector<int> indices; // insertion order
+};
+
+struct NamedPolicy {
+	string name;
+	HybridTablePolicy policy;
+};
+
+static double nanosecondsSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+// indices drawn without repetition from [0, BENCH_ENTRIES * spread), in random order
+static Workload makeWorkload(const string& name, int spread, mt19937& rng) {
+	Workload workload;
+	workload.name = name;
+	vector<int> all(BENCH_ENTRIES * spread);
+	for(int i = 0; i < (int)all.size(); i++) all[i] = i;
+	shuffle(all.begin(), all.end(), rng);
+	workload.indices.assign(all.begin(), all.begin() + BENCH_ENTRIES);
+	return workload;
+}
+
+// sweeps growth policies over dense, half dense and sparse index sets
+static void benchPolicies() {
+	mt19937 rng(42);
+	vector<Workload> workloads;
+	workloads.push_back(makeWorkload("dense", 1, rng));
+	workloads.push_back(makeWorkload("half", 2, rng));
+	workloads.push_back(makeWorkload("sparse", 16, rng));
+
+	vector<NamedPolicy> policies(5);
+	policies[0].name = "default";
+	policies[1].name = "aggressive";
+	policies[1].policy.density_percent = 60;
+	policies[1].policy.growth_shift = 2;
+	policies[2].name = "density60";
+	policies[2].policy.density_percent = 60;
+	policies[3].name = "density90";
+	policies[3].policy.density_percent = 90;
+	policies[4].name = "capped";
+	policies[4].policy.max_array_size = BENCH_ENTRIES / 4;
+
+	cout << "policy sweep (" << BENCH_ENTRIES << " entries)" << endl;
+	cout << left << setw(10) << "workload" << setw(12) << "policy"
+	     << right << setw(12) << "array size" << setw(12) << "list size"
+	     << setw(14) << "bytes/entry" << setw(12) << "set ns" << setw(12) << "get ns" << endl;
+
+	for(const Workload& workload : workloads) {
+		// random probes over the whole index range, about half of them hits
+		vector<int> probes(BENCH_ENTRIES);
+		uniform_int_distribution<int> pick(0, BENCH_ENTRIES - 1);
+		for(int i = 0; i < BENCH_ENTRIES; i++) {
+			probes[i] = (i % 2 == 0) ? workload.indices[pick(rng)] : workload.indices[pick(rng)] + 1;
+		}
+
+		for(const NamedPolicy& named : policies) {
+			HybridTable t;
+			t.setPolicy(named.policy);
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for(int index : workload.indices) t.set(index, index);
+			double set_ns = nanosecondsSince(start) / BENCH_ENTRIES;
+
+			long long checksum = 0;
+			start = chrono::steady_clock::now();
+			for(int index : probes) checksum += t.get(index);
+			double get_ns = nanosecondsSince(start) / BENCH_ENTRIES;
+
+			cout << left << setw(10) << workload.name << setw(12) << named.name
+			     << right << setw(12) << t.getArraySize() << setw(12) << (t.getTotalSize() - t.getArraySize())
+			     << setw(14) << fixed << setprecision(1) << (double)t.memoryUsage().total() / BENCH_ENTRIES
+			     << setw(12) << set_ns << setw(12) << get_ns
+			     << (checksum == 0 ? " (empty)" : "") << endl;
+		}
+	}
+	cout << endl;
+}
+
+// merge() against the element by element get/set loop it replaces
+static void benchMerge() {
+	const int dense = 1 << 20;
+	const int sparse = 1 << 12;
+	vector<int> values(dense);
+	for(int i = 0; i < dense; i++) values[i] = i;
+
+	// decreasing indices, so every list insert is at the head
+	HybridTable a(values.data(), dense), b(values.data(), dense);
+	for(int i = sparse; i > 0; i--) {
+		a.set(4 * dense + 2 * i, i);
+		b.set(4 * dense + 3 * i, i);
+	}
+
+	cout << "merge (" << dense << " array + " << sparse << " list entries each)" << endl;
+	for(int round = 0; round < 2; round++) {
+		HybridTable merged(a);
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if(round == 0) {
+			merged.merge(b, MergeCombiner::ADD);
+		}
+		else {
+			for(int i = 0; i < dense; i++) merged.set(i, merged.get(i) + b.get(i));
+			for(int i = sparse; i > 0; i--) merged.set(4 * dense + 3 * i, merged.get(4 * dense + 3 * i) + i);
+		}
+		double ms = nanosecondsSince(start) / 1e6;
+		cout << left << setw(12) << (round == 0 ? "merge" : "get/set") << right << setw(12) << fixed << setprecision(2) << ms << " ms"
+		     << "   total size " << merged.getTotalSize() << endl;
+	}
+	cout << endl;
+}
+
+// bulkLoad of unsorted input with a growing number of threads
+static void benchBulkLoad() {
+	const int count = 1 << 22;
+	mt19937 rng(7);
+	uniform_int_distribution<int> sparse_index(INT_MIN, INT_MAX);
+	vector<pair<int, int>> entries(count);
+	for(int i = 0; i < count; i++) {
+		// three quarters dense, the rest anywhere
+		int index = (i % 4 != 0) ? i : sparse_index(rng);
+		entries[i] = make_pair(index, i);
+	}
+	shuffle(entries.begin(), entries.end(), rng);
+
+	cout << "bulkLoad (" << count << " unsorted entries)" << endl;
+	for(int threads = 1; threads <= 16; threads *= 2) {
+		ThreadPool pool(threads);
+		HybridTable t;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		t.bulkLoad(entries.data(), entries.size(), &pool);
+		double ms = nanosecondsSince(start) / 1e6;
+		cout << setw(3) << threads << " threads" << setw(12) << fixed << setprecision(2) << ms << " ms"
+		     << "   array size " << t.getArraySize() << endl;
+	}
+	cout << endl;
+}
+
+// sparse appends past the array part, plain and with hints; the growth
+// check resumes its scan, so the cost per append stays flat as n grows
+static void benchAppends() {
+	cout << "sparse appends" << endl;
+	for(int count : {20000, 80000}) {
+		for(int hinted = 0; hinted < 2; hinted++) {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			HybridTable t;
+			HybridTable::Hint hint;
+			for(int i = 0; i < count; i++) {
+				if (hinted) hint = t.set(hint, 1000000 + 7 * i, i);
+				else t.set(1000000 + 7 * i, i);
+			}
+			double ns = nanosecondsSince(start) / count;
+			cout << setw(6) << count << left << setw(10) << (hinted ? " hinted" : " plain") << right << setw(12) << fixed << setprecision(1) << ns << " ns"
+			     << "   array size " << t.getArraySize() << endl;
+		}
+	}
+	cout << endl;
+}
+
+// get() misses on a sparse table, with and without the list filter
+static void benchListFilter() {
+	mt19937 rng(11);
+	HybridTable plain;
+	for(int i = BENCH_ENTRIES; i > 0; i--) plain.set(1000 * i, i);   // decreasing, head inserts
+	HybridTable filtered(plain);
+	filtered.enableListFilter();
+
+	vector<int> probes(1 << 16);
+	for(int& probe : probes) probe = 1000 * (int)(rng() % BENCH_ENTRIES) + 1 + (int)(rng() % 999);
+
+	cout << "get() misses (" << BENCH_ENTRIES << " list entries)" << endl;
+	for(int round = 0; round < 2; round++) {
+		const HybridTable& t = (round == 0) ? plain : filtered;
+		long long checksum = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(int probe : probes) checksum += t.get(probe);
+		double ns = nanosecondsSince(start) / probes.size();
+		cout << left << setw(12) << (round == 0 ? "no filter" : "filter") << right << setw(12) << fixed << setprecision(1) << ns << " ns"
+		     << (checksum != 0 ? " (hits?)" : "") << endl;
+	}
+	cout << endl;
+}
+
+static void benchFreeze() {
+	mt19937 rng(13);
+	HybridTable table;
+	for(int i = 0; i < BENCH_ENTRIES; i++) table.set(i, i);
+	for(int i = BENCH_ENTRIES; i > 0; i--) table.set(1000 * i + BENCH_ENTRIES, i);   // list part
+	table.enableListFilter();
+	FrozenHybridTable frozen = table.freeze();
+
+	// half array hits, half list hits
+	vector<int> probes(1 << 16);
+	for(size_t k = 0; k < probes.size(); k++) {
+		int entry = (int)(rng() % BENCH_ENTRIES);
+		probes[k] = (k % 2 == 0) ? entry : 1000 * (entry + 1) + BENCH_ENTRIES;
+	}
+	vector<int> out(probes.size());
+
+	cout << "get() hits (" << BENCH_ENTRIES << " array, " << BENCH_ENTRIES << " list entries)" << endl;
+	for(int round = 0; round < 3; round++) {
+		long long checksum = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (round == 0) {
+			for(int probe : probes) checksum += table.get(probe);
+		} else if (round == 1) {
+			for(int probe : probes) checksum += frozen.get(probe);
+		} else {
+			frozen.getMany(probes.data(), out.data(), probes.size());
+			for(int val : out) checksum += val;
+		}
+		double ns = nanosecondsSince(start) / probes.size();
+		cout << left << setw(12) << (round == 0 ? "mutable" : (round == 1 ? "frozen" : "getMany")) << right << setw(12)
+		     << fixed << setprecision(1) << ns << " ns (checksum " << checksum << ")" << endl;
+	}
+	cout << endl;
+}
+
+static void benchSnapshot() {
+	const int array_size = 1 << 22;
+	mt19937 rng(17);
+	vector<int> values(array_size, 1);
+	HybridTable table(values.data(), array_size);
+
+	vector<int> probes(1 << 20);
+	for(int& probe : probes) probe = (int)(rng() % array_size);
+
+	cout << "set() into " << array_size << " array slots" << endl;
+	for(int round = 0; round < 2; round++) {
+		ostringstream image;
+		if (round == 1) table.startSnapshot(image);
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(int probe : probes) table.set(probe, probe);
+		double ns = nanosecondsSince(start) / probes.size();
+		bool still_running = table.isSnapshotRunning();
+		table.finishSnapshot();
+		cout << left << setw(12) << (round == 0 ? "plain" : "snapshot") << right << setw(12) << fixed << setprecision(1) << ns << " ns"
+		     << (still_running ? " (snapshot outlasted the sets)" : "") << endl;
+	}
+	cout << endl;
+}
+
+static void benchWriter() {
+	const int threads = 4, per_thread = 1 << 18;
+
+	cout << "shared set() from " << threads << " threads, " << per_thread << " each" << endl;
+	for(int round = 0; round < 2; round++) {
+		ConcurrentHybridTable shared(HybridTable(vector<int>(threads * per_thread).data(), threads * per_thread));
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<thread> workers;
+		for(int t = 0; t < threads; t++) {
+			workers.push_back(thread([&shared, round, t, per_thread](){
+				mt19937 rng(19 + t);
+				if (round == 0) {
+					for(int k = 0; k < per_thread; k++) shared.set((int)(rng() % (threads * per_thread)), k);
+				} else {
+					HybridTableWriter writer(shared);
+					for(int k = 0; k < per_thread; k++) writer.set((int)(rng() % (threads * per_thread)), k);
+				}
+			}));
+		}
+		for(thread& worker : workers) worker.join();
+		double ns = nanosecondsSince(start) / ((double)threads * per_thread);
+		cout << left << setw(12) << (round == 0 ? "locked set" : "writer") << right << setw(12) << fixed << setprecision(1) << ns << " ns" << endl;
+	}
+	cout << endl;
+}
+
+static void benchCounters() {
+	const int counters = 1 << 16, increments = 1 << 20, threads = 4;
+	mt19937 rng(23);
+	vector<int> probes(increments);
+	for(int& probe : probes) probe = (int)(rng() % counters);
+
+	cout << "counter increments over " << counters << " array slots" << endl;
+	for(int round = 0; round < 2; round++) {
+		HybridTable table(vector<int>(counters).data(), counters);
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (round == 0) {
+			for(int probe : probes) table.set(probe, table.get(probe) + 1);
+		} else {
+			for(int probe : probes) table.add(probe, 1);
+		}
+		double ns = nanosecondsSince(start) / increments;
+		cout << left << setw(12) << (round == 0 ? "get+set" : "add") << right << setw(12) << fixed << setprecision(1) << ns << " ns" << endl;
+	}
+	for(int round = 0; round < 2; round++) {
+		ConcurrentHybridTable shared(HybridTable(vector<int>(counters).data(), counters));
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<thread> workers;
+		for(int t = 0; t < threads; t++) {
+			workers.push_back(thread([&shared, &probes, round, t, threads](){
+				for(size_t k = t; k < probes.size(); k += threads) {
+					if (round == 0) {
+						shared.update([&](HybridTable& table){ return table.add(probes[k], 1); });
+					} else {
+						shared.add(probes[k], 1);
+					}
+				}
+			}));
+		}
+		for(thread& worker : workers) worker.join();
+		double ns = nanosecondsSince(start) / increments;
+		cout << left << setw(12) << (round == 0 ? "locked add" : "atomic add") << right << setw(12) << fixed << setprecision(1) << ns
+		     << " ns (" << threads << " threads)" << endl;
+	}
+	cout << endl;
+}
+
+// sparse set() on a VersionedHybridTable: every write lands in the list
+// part and copies only the list segment it touches
+static void benchVersioned() {
+	cout << "versioned sparse set()" << endl;
+	for(int count : {10000, 20000, 40000}) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		VersionedHybridTable v;
+		for(int i = 0; i < count; i++) v.set(1000000 + 7 * i, i);
+		cout << setw(6) << count << " writes" << setw(12) << fixed << setprecision(1) << nanosecondsSince(start) / count << " ns"
+		     << "   array size " << v.pin().getArraySize() << endl;
+	}
+	cout << endl;
+}
+
+static void benchReplication() {
+	const int array_size = 1 << 22;
+	mt19937 rng(31);
+	vector<int> values(array_size);
+	for(int& val : values) val = (int)(rng() % 1000);
+	HybridTable primary(values.data(), array_size), replica(primary);
+	for(int k = 0; k < 100; k++) primary.set((int)(rng() % array_size), -1);
+
+	cout << "replicating 100 changes over " << array_size << " array slots" << endl;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	size_t dump_bytes = primary.toString().size();
+	cout << left << setw(12) << "toString" << right << setw(12) << fixed << setprecision(1) << nanosecondsSince(start) / 1e6 << " ms, "
+	     << dump_bytes << " bytes" << endl;
+	start = chrono::steady_clock::now();
+	vector<unsigned char> delta = HybridTable::diff(replica, primary);
+	cout << left << setw(12) << "diff" << right << setw(12) << nanosecondsSince(start) / 1e6 << " ms, " << delta.size() << " bytes" << endl;
+	start = chrono::steady_clock::now();
+	replica.applyPatch(delta);
+	cout << left << setw(12) << "applyPatch" << right << setw(12) << nanosecondsSince(start) / 1e6 << " ms" << endl;
+	start = chrono::steady_clock::now();
+	bool same = (replica == primary) && (replica.hash() == primary.hash());
+	cout << left << setw(12) << "== and hash" << right << setw(12) << nanosecondsSince(start) / 1e6 << " ms" << (same ? "" : " (differ!)") << endl;
+	cout << endl;
+}
+
+static void benchResources() {
+	const int tables = 2000;
+	const int entries = 200;
+	mt19937 rng(37);
+	vector<int> indices(entries);
+	for(int& index : indices) index = (int)(rng() % 100000) - 50000;
+
+	cout << tables << " short-lived tables of " << entries << " sparse entries" << endl;
+	for(int arena = 0; arena < 2; arena++){
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(int t = 0; t < tables; t++){
+			pmr::monotonic_buffer_resource buffer(1 << 14);
+			HybridTable table(arena ? (pmr::memory_resource*)&buffer : pmr::get_default_resource());
+			for(int k = 0; k < entries; k++) table.set(indices[k], k);
+		}
+		cout << left << setw(12) << (arena ? "monotonic" : "new/delete") << right << setw(12) << fixed << setprecision(1)
+		     << nanosecondsSince(start) / ((double)tables * entries) << " ns/set" << endl;
+	}
+	cout << endl;
+}
+
+static void benchHugePages() {
+	const int array_size = 1 << 26;
+	const int reads = 1 << 23;
+	mt19937 rng(41);
+	vector<int> values(array_size, 1);
+	vector<int> probes(reads);
+	for(int& index : probes) index = (int)(rng() % array_size);
+
+	cout << "random get over " << array_size << " array slots (" << (array_size >> 18) << " MB)" << endl;
+	for(int huge = 0; huge < 2; huge++){
+		HybridTable t(values.data(), array_size);
+		HybridTablePolicy policy;
+		policy.array_alignment = 64;
+		policy.huge_page_bytes = huge ? HybridTable::HUGE_PAGE_SIZE : 0;
+		t.setPolicy(policy);
+		long long checksum = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(int index : probes) checksum += t.get(index);
+		cout << left << setw(12) << (huge ? "huge pages" : "64 aligned") << right << setw(12) << fixed << setprecision(1)
+		     << nanosecondsSince(start) / reads << " ns/get" << (checksum == reads ? "" : " (wrong sum!)") << endl;
+	}
+	cout << endl;
+}
+
+static void benchParse() {
+	const int array_size = 1 << 23;
+	mt19937 rng(59);
+	vector<int> values(array_size);
+	for(int& val : values) val = (int)rng() >> (rng() % 32);
+	HybridTable t(values.data(), array_size);
+	for(int k = 0; k < 100000; k++) t.set(array_size + (int)(rng() % (1 << 28)), (int)rng());
+	string text = t.toString();
+
+	cout << "parsing a " << text.size() / 1000000 << " MB toString() dump" << endl;
+	HybridTable parsed;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	bool parsed_ok = parsed.fromString(text);
+	double seconds = nanosecondsSince(start) / 1e9;
+	bool same = parsed_ok && (parsed == t);
+	cout << left << setw(12) << "fromString" << right << setw(12) << fixed << setprecision(1) << text.size() / 1e6 / seconds << " MB/s"
+	     << (same ? "" : " (differ!)") << endl;
+	cout << endl;
+}
+
+static void benchCompression() {
+	const int array_size = 1 << 24;
+	mt19937 rng(67);
+	vector<int> values(array_size, 0);
+	for(int run = 0; run < 2000; run++){
+		int start = (int)(rng() % array_size);
+		fill(values.begin() + start, values.begin() + std::min(array_size, start + (int)(rng() % 4096)), -1);
+	}
+	HybridTable plain(values.data(), array_size);
+	CompressedHybridTable compressed(plain);
+	vector<int> probes(1 << 20);
+	for(int& index : probes) index = (int)(rng() % array_size);
+
+	cout << "run length compression of " << array_size << " mostly 0 array slots" << endl;
+	long long checksum = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int index : probes) checksum += plain.get(index);
+	double plain_ns = nanosecondsSince(start) / probes.size();
+	start = chrono::steady_clock::now();
+	for(int index : probes) checksum -= compressed.get(index);
+	double compressed_ns = nanosecondsSince(start) / probes.size();
+	cout << left << setw(12) << "plain" << right << setw(12) << plain.memoryUsage().total() << " bytes" << setw(10) << fixed
+	     << setprecision(1) << plain_ns << " ns/get" << endl;
+	cout << left << setw(12) << "compressed" << right << setw(12) << compressed.memoryUsage().total() << " bytes" << setw(10)
+	     << compressed_ns << " ns/get" << (checksum == 0 ? "" : " (differ!)") << endl;
+	cout << endl;
+}
+
+// HybridMatrix::multiply() against a get() per matrix entry
+static void benchMatrix() {
+	const int rows = 2000, cols = 20000;
+	mt19937 rng(73);
+	vector<HybridTable> tables(rows);
+	vector<int> dense(cols / 2);
+	for(int r = 0; r < rows; r++){
+		for(int& val : dense) val = (int)(rng() % 100);
+		tables[r] = HybridTable(dense.data(), (int)dense.size() >> (r % 8));
+		for(int k = 0; k < 64; k++) tables[r].set(cols / 2 + (int)(rng() % (cols / 2)), (int)(rng() % 100));
+	}
+	HybridMatrix matrix(tables.data(), rows, cols);
+	vector<double> x(cols, 0.5), y(rows);
+
+	cout << "matrix-vector product of " << rows << " hybrid rows x " << cols << " columns" << endl;
+	double checksum = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int r = 0; r < rows; r++){
+		double sum = 0;
+		for(int c = 0; c < cols; c++) sum += tables[r].get(c) * x[c];
+		checksum += sum;
+	}
+	double get_ms = nanosecondsSince(start) / 1e6;
+	cout << left << setw(12) << "get()" << right << setw(10) << fixed << setprecision(2) << get_ms << " ms" << endl;
+	for(int threads : {1, 4}){
+		ThreadPool pool(threads);
+		start = chrono::steady_clock::now();
+		matrix.multiply(x.data(), y.data(), &pool);
+		double multiply_ms = nanosecondsSince(start) / 1e6;
+		double total = 0;
+		for(double val : y) total += val;
+		cout << left << setw(12) << ("multiply/" + to_string(threads)) << right << setw(10) << multiply_ms << " ms"
+		     << (total == checksum ? "" : " (differ!)") << endl;
+	}
+	cout << endl;
+}
+
+int main() {
+	benchPolicies();
+	benchMerge();
+	benchBulkLoad();
+	benchAppends();
+	benchListFilter();
+	benchFreeze();
+	benchSnapshot();
+	benchWriter();
+	benchCounters();
+	benchVersioned();
+	benchReplication();
+	benchResources();
+	benchHugePages();
+	benchParse();
+	benchCompression();
+	benchMatrix();
+	return 0;
+}
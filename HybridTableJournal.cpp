@@ -0,0 +1,303 @@
+#include "HybridTableJournal.h"
+#include "FrozenHybridTable.h"
+#include "HybridTable.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+
+// first bytes of a journal file; batches follow as
+// [record count][checksum of the records][count x (index, value)], 32 bits each
+static const char JOURNAL_MAGIC[4] = {'H', 'T', 'J', '1'};
+static const size_t BATCH_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+// FNV-1a over the record bytes of a batch
+static uint32_t batchChecksum(const unsigned char* bytes, size_t size) {
+    uint32_t hash = 2166136261u;
+    for(size_t itr = 0; itr < size; itr++){
+        hash = (hash ^ bytes[itr]) * 16777619u;
+    }
+    return hash;
+}
+
+// write() until everything is out, returns false on an error
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = (const char*)data;
+    while(size > 0){
+        ssize_t written = write(fd, bytes, size);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+// fsyncs the directory holding path, so a rename into it survives a crash
+static bool syncParentDirectory(const string& path) {
+    size_t slash = path.find_last_of('/');
+    string directory = (slash == string::npos) ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0){
+        return false;
+    }
+    bool ok = (fsync(fd) == 0);
+    close(fd);
+    return ok;
+}
+
+HybridTableJournal::HybridTableJournal(const string& path, const HybridTableJournalOptions& options)
+    : path_(path), options_(options) {
+    fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd_ < 0){
+        return;
+    }
+
+    off_t size = lseek(fd_, 0, SEEK_END);
+    bool ok = (size >= 0);
+    if(size == 0){
+        ok = writeAll(fd_, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) && (fsync(fd_) == 0);
+    }
+    else if(ok){
+        // drop a batch that was only partly written when the process died
+        bool valid = false;
+        long long end = readBatches(nullptr, valid);
+        ok = valid && ((end == size) || (ftruncate(fd_, end) == 0));
+    }
+    if(!ok){
+        close(fd_);
+        fd_ = -1;
+        return;
+    }
+
+    if(options_.sync_interval_ms > 0){
+        flusher_ = thread(&HybridTableJournal::flusherLoop, this);
+    }
+}
+
+HybridTableJournal::~HybridTableJournal() {
+    {
+        lock_guard<mutex> lock(buffer_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if(flusher_.joinable()){
+        flusher_.join();
+    }
+
+    if(fd_ >= 0){
+        lock_guard<mutex> lock(io_mutex_);
+        writeBufferedLocked(true);
+        close(fd_);
+    }
+}
+
+bool HybridTableJournal::isOpen() const {
+    return fd_ >= 0;
+}
+
+void HybridTableJournal::append(int i, int val) {
+    if(options_.sync_interval_ms <= 0){
+        lock_guard<mutex> io_lock(io_mutex_);
+        {
+            lock_guard<mutex> lock(buffer_mutex_);
+            buffer_.push_back(Record(i, val));
+        }
+        writeBufferedLocked(true);
+        return;
+    }
+
+    bool full;
+    {
+        lock_guard<mutex> lock(buffer_mutex_);
+        buffer_.push_back(Record(i, val));
+        full = (buffer_.size() >= options_.batch_records);
+    }
+    if(full){
+        wake_.notify_one();
+    }
+}
+
+bool HybridTableJournal::sync() {
+    lock_guard<mutex> lock(io_mutex_);
+    return writeBufferedLocked(true);
+}
+
+bool HybridTableJournal::replay(HybridTable& table, ThreadPool* pool) {
+    if(!isOpen() || !sync()){
+        return false;
+    }
+
+    // snapshot entries first, then the journal in order, so later records win in bulkLoad
+    vector<Record> entries;
+    ifstream snapshot(getSnapshotPath(), ios::binary);
+    if(snapshot){
+        FrozenHybridTable frozen;
+        if(!frozen.deserialize(snapshot)){
+            return false;
+        }
+        entries.reserve(frozen.getTotalSize());
+        frozen.forEach([&](int index, int val){
+            entries.push_back(Record(index, val));
+        });
+    }
+
+    bool valid = false;
+    {
+        lock_guard<mutex> lock(io_mutex_);
+        readBatches(&entries, valid);
+    }
+    if(!valid){
+        return false;
+    }
+
+    table.bulkLoad(entries.data(), entries.size(), pool);
+    return true;
+}
+
+bool HybridTableJournal::compact(const HybridTable& table) {
+    if(!isOpen()){
+        return false;
+    }
+
+    // no batch may be written between the snapshot and the truncation below
+    lock_guard<mutex> lock(io_mutex_);
+    if(!writeBufferedLocked(true)){
+        return false;
+    }
+
+    ostringstream image;
+    table.freeze().serialize(image);
+    string bytes = image.str();
+
+    // write the snapshot aside and rename it over the old one, so a crash leaves one or the other
+    string snapshot_path = getSnapshotPath();
+    string temporary_path = snapshot_path + ".tmp";
+    int snapshot_fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(snapshot_fd < 0){
+        return false;
+    }
+    bool ok = writeAll(snapshot_fd, bytes.data(), bytes.size()) && (fsync(snapshot_fd) == 0);
+    close(snapshot_fd);
+    if(!ok || (rename(temporary_path.c_str(), snapshot_path.c_str()) != 0) || !syncParentDirectory(snapshot_path)){
+        unlink(temporary_path.c_str());
+        return false;
+    }
+
+    // replaying the old journal over the new snapshot would change nothing, so a crash before this is fine
+    if((ftruncate(fd_, sizeof(JOURNAL_MAGIC)) != 0) || (fdatasync(fd_) != 0)){
+        failed_ = true;
+        return false;
+    }
+    unsynced_ = false;
+    return true;
+}
+
+string HybridTableJournal::getSnapshotPath() const {
+    return path_ + ".snapshot";
+}
+
+bool HybridTableJournal::writeBufferedLocked(bool sync) {
+    vector<Record> batch;
+    {
+        lock_guard<mutex> lock(buffer_mutex_);
+        batch.swap(buffer_);
+    }
+    if((fd_ < 0) || failed_){
+        return false;
+    }
+
+    if(!batch.empty()){
+        if(!writeBatchLocked(batch)){
+            failed_ = true;
+            return false;
+        }
+        unsynced_ = true;
+    }
+    if(sync && unsynced_){
+        if(fdatasync(fd_) != 0){
+            failed_ = true;
+            return false;
+        }
+        unsynced_ = false;
+    }
+    return true;
+}
+
+bool HybridTableJournal::writeBatchLocked(const vector<Record>& batch) {
+    size_t payload_size = batch.size() * 2 * sizeof(int32_t);
+    vector<unsigned char> frame(BATCH_HEADER_SIZE + payload_size);
+
+    unsigned char* payload = frame.data() + BATCH_HEADER_SIZE;
+    for(size_t itr = 0; itr < batch.size(); itr++){
+        int32_t record[2] = {batch[itr].first, batch[itr].second};
+        memcpy(payload + itr * sizeof(record), record, sizeof(record));
+    }
+    uint32_t header[2] = {(uint32_t)batch.size(), batchChecksum(payload, payload_size)};
+    memcpy(frame.data(), header, sizeof(header));
+
+    // one write() per batch, so a crash tears at most this batch
+    return writeAll(fd_, frame.data(), frame.size());
+}
+
+long long HybridTableJournal::readBatches(vector<Record>* records, bool& valid) const {
+    ifstream in(path_, ios::binary);
+    vector<unsigned char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    valid = (bytes.size() >= sizeof(JOURNAL_MAGIC)) && (memcmp(bytes.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0);
+    if(!valid){
+        return 0;
+    }
+
+    size_t position = sizeof(JOURNAL_MAGIC);
+    while(bytes.size() - position >= BATCH_HEADER_SIZE){
+        uint32_t header[2];
+        memcpy(header, bytes.data() + position, sizeof(header));
+        size_t payload_size = (size_t)header[0] * 2 * sizeof(int32_t);
+        const unsigned char* payload = bytes.data() + position + BATCH_HEADER_SIZE;
+        if((bytes.size() - position - BATCH_HEADER_SIZE < payload_size) || (batchChecksum(payload, payload_size) != header[1])){
+            break;  // torn or damaged, nothing after it counts
+        }
+
+        if(records != nullptr){
+            for(size_t itr = 0; itr < header[0]; itr++){
+                int32_t record[2];
+                memcpy(record, payload + itr * sizeof(record), sizeof(record));
+                records->push_back(Record(record[0], record[1]));
+            }
+        }
+        position += BATCH_HEADER_SIZE + payload_size;
+    }
+    return (long long)position;
+}
+
+void HybridTableJournal::flusherLoop() {
+    unique_lock<mutex> lock(buffer_mutex_);
+    while(!stopping_){
+        wake_.wait_for(lock, chrono::milliseconds(options_.sync_interval_ms), [&](){
+            return stopping_ || (buffer_.size() >= options_.batch_records);
+        });
+        if(stopping_){
+            break;
+        }
+
+        // everything buffered up to now goes out in one batch and one fsync
+        lock.unlock();
+        {
+            lock_guard<mutex> io_lock(io_mutex_);
+            writeBufferedLocked(true);
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef HYBRIDTABLEJOURNAL_H_
+#define HYBRIDTABLEJOURNAL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class HybridTable;
+class ThreadPool;
+
+// When buffered set() records reach the journal file
+struct HybridTableJournalOptions {
+	size_t batch_records = 4096; // a batch this big is written without waiting for the timer
+	int sync_interval_ms = 50;   // buffered records are written and fsync'ed at least this often;
+	                             // 0 writes and fsyncs inside every append()
+};
+
+// An append only log of set() calls, so a table can be rebuilt after a
+// crash. Records are buffered in memory; a background thread writes all
+// records buffered so far as one checksummed batch and fsyncs it (group
+// commit), so one fsync covers every set() since the previous one. At
+// most sync_interval_ms of writes are lost in a crash, and a torn last
+// batch is dropped. compact() replaces the log by a binary snapshot of
+// the table (at path + ".snapshot"), and replay() loads snapshot and log
+// back through bulkLoad(). Only set() is journaled: after assigning,
+// merging or bulk loading a journaled table, call compact().
+class HybridTableJournal {
+
+public:
+	// Opens (or creates) the journal at path and starts the flusher thread.
+	// A torn batch at the end of an existing journal is cut off.
+	explicit HybridTableJournal(const std::string& path, const HybridTableJournalOptions& options = HybridTableJournalOptions());
+
+	// Writes and fsyncs what is buffered, then stops the flusher thread.
+	~HybridTableJournal();
+
+	HybridTableJournal(const HybridTableJournal&) = delete;
+	HybridTableJournal& operator=(const HybridTableJournal&) = delete;
+
+	// Returns false if the journal file could not be opened or is not a journal.
+	bool isOpen() const;
+
+	// Buffers a set(i, val) record. Safe to call from several threads.
+	void append(int i, int val);
+
+	// Writes and fsyncs every record appended so far. Returns false on an I/O error.
+	bool sync();
+
+	// Replaces the contents of table with the snapshot followed by the
+	// journal. Returns false if either file is damaged (a torn last batch
+	// does not count).
+	bool replay(HybridTable& table, ThreadPool* pool = nullptr);
+
+	// Writes a snapshot of table, which must hold every set() appended so
+	// far, and empties the journal. Returns false on an I/O error, in which
+	// case the old snapshot and journal are kept.
+	bool compact(const HybridTable& table);
+
+	// Returns the path of the snapshot written by compact().
+	std::string getSnapshotPath() const;
+
+private:
+
+	typedef std::pair<int, int> Record; // (index, value)
+
+	std::string path_;
+	HybridTableJournalOptions options_;
+	int fd_ = -1;
+	bool failed_ = false;              // an earlier write failed, the file can't be trusted
+	bool unsynced_ = false;            // batches were written since the last fsync
+
+	std::mutex buffer_mutex_;          // guards buffer_ and stopping_
+	std::condition_variable wake_;     // buffer_ full or stopping_
+	std::vector<Record> buffer_;       // records not yet written
+	bool stopping_ = false;
+
+	std::mutex io_mutex_;              // one writer of fd_ at a time
+	std::thread flusher_;
+
+	// writes buffered records (and fsyncs if sync is set); io_mutex_ must be held
+	bool writeBufferedLocked(bool sync);
+
+	// appends one batch frame to fd_; io_mutex_ must be held
+	bool writeBatchLocked(const std::vector<Record>& batch);
+
+	// reads the batches of the journal file into records, returns the offset past the last whole batch
+	long long readBatches(std::vector<Record>* records, bool& valid) const;
+
+	// wakes every sync_interval_ms (or on a full buffer) and writes out the buffer
+	void flusherLoop();
+};
+
+#endif /* HYBRIDTABLEJOURNAL_H_ */
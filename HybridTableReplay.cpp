@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "ArrayKernels.h"
+#include "ConcurrentHybridTable.h"
+#include "HybridTable.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// Replays a recorded trace of operations against a HybridTable and reports
+// throughput, latency percentiles, array part resizes and the final memory.
+//
+//     HybridTableReplay [-t threads] [-w binary_out] trace
+//
+// A text trace has one operation per line: "get i", "set i v", "copy" (copy
+// construct a temporary from the table) or "assign" (copy assign the table
+// to a scratch table). Blank lines and lines starting with '#' are skipped.
+// A binary trace starts with "HTR1" and has one record per operation: the
+// operation code (0 get, 1 set, 2 copy, 3 assign) in one byte, then i and v
+// as little endian 32 bit ints for get and set. -w writes the trace in the
+// binary form, which loads faster than text.
+//
+// The trace is replayed twice on fresh tables: once at full speed for the
+// throughput, and once with every operation timed (clock reads included)
+// for the latencies and resize counts. With -t the operations are dealt
+// out round robin to that many threads, which share a ConcurrentHybridTable.
+
+enum OperationCode : unsigned char { GET = 0, SET = 1, COPY = 2, ASSIGN = 3, OPERATION_CODES = 4 };
+
+static const char* const OPERATION_NAMES[OPERATION_CODES] = {"get", "set", "copy", "assign"};
+
+struct Operation {
+	OperationCode code;
+	int index;
+	int val;
+};
+
+// per thread results of the timed replay
+struct ReplayTimes {
+	vector<uint32_t> latencies[OPERATION_CODES]; // nanoseconds, one per operation
+	long long resizes = 0;
+	long long checksum = 0;                      // sum of the values read, so nothing is optimised away
+};
+
+static const char BINARY_MAGIC[4] = {'H', 'T', 'R', '1'};
+
+static bool parseTextTrace(const string& text, vector<Operation>& trace) {
+	const char* p = text.data();
+	const char* end = p + text.size();
+	long long line = 1;
+	while(p < end){
+		const char* line_end = (const char*)memchr(p, '\n', end - p);
+		if(line_end == nullptr){
+			line_end = end;
+		}
+		const char* last = line_end;
+		if((last > p) && (last[-1] == '\r')){
+			last--;
+		}
+
+		Operation operation = {GET, 0, 0};
+		bool ok = true;
+		if((last == p) || (*p == '#')){
+			// nothing on this line
+		}
+		else if((last - p > 4) && (memcmp(p, "get ", 4) == 0)){
+			ok = parseInt(p + 4, last, operation.index) == last;
+			trace.push_back(operation);
+		}
+		else if((last - p > 4) && (memcmp(p, "set ", 4) == 0)){
+			operation.code = SET;
+			const char* val_start = parseInt(p + 4, last, operation.index);
+			ok = (val_start != nullptr) && (val_start < last) && (*val_start == ' ') && (parseInt(val_start + 1, last, operation.val) == last);
+			trace.push_back(operation);
+		}
+		else if((last - p == 4) && (memcmp(p, "copy", 4) == 0)){
+			operation.code = COPY;
+			trace.push_back(operation);
+		}
+		else if((last - p == 6) && (memcmp(p, "assign", 6) == 0)){
+			operation.code = ASSIGN;
+			trace.push_back(operation);
+		}
+		else{
+			ok = false;
+		}
+		if(!ok){
+			cerr << "line " << line << ": not an operation: " << string(p, last) << endl;
+			return false;
+		}
+		p = line_end + 1;
+		line++;
+	}
+	return true;
+}
+
+static bool parseBinaryTrace(const string& data, vector<Operation>& trace) {
+	size_t pos = sizeof(BINARY_MAGIC);
+	while(pos < data.size()){
+		Operation operation = {(OperationCode)data[pos], 0, 0};
+		pos++;
+		size_t ints = (operation.code == SET) ? 2 : (operation.code == GET) ? 1 : 0;
+		if((operation.code >= OPERATION_CODES) || (data.size() - pos < 4 * ints)){
+			cerr << "byte " << pos - 1 << ": not an operation" << endl;
+			return false;
+		}
+		uint32_t fields[2] = {0, 0};
+		for(size_t itr = 0; itr < ints; itr++){
+			for(int byte = 0; byte < 4; byte++){
+				fields[itr] |= (uint32_t)(unsigned char)data[pos++] << (8 * byte);
+			}
+		}
+		operation.index = (int)fields[0];
+		operation.val = (int)fields[1];
+		trace.push_back(operation);
+	}
+	return true;
+}
+
+static bool loadTrace(const string& path, vector<Operation>& trace) {
+	ifstream in(path, ios::binary);
+	if(!in){
+		cerr << "can't open " << path << endl;
+		return false;
+	}
+	string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	if((data.size() >= sizeof(BINARY_MAGIC)) && (memcmp(data.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0)){
+		return parseBinaryTrace(data, trace);
+	}
+	return parseTextTrace(data, trace);
+}
+
+static bool writeBinaryTrace(const string& path, const vector<Operation>& trace) {
+	string data(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	for(const Operation& operation : trace){
+		data.push_back((char)operation.code);
+		uint32_t fields[2] = {(uint32_t)operation.index, (uint32_t)operation.val};
+		size_t ints = (operation.code == SET) ? 2 : (operation.code == GET) ? 1 : 0;
+		for(size_t itr = 0; itr < ints; itr++){
+			for(int byte = 0; byte < 4; byte++){
+				data.push_back((char)(fields[itr] >> (8 * byte)));
+			}
+		}
+	}
+	ofstream out(path, ios::binary);
+	out.write(data.data(), data.size());
+	return (bool)out;
+}
+
+static double nanosecondsSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+// runs one operation on a plain table, returning the value read (if any)
+static inline long long runOperation(const Operation& operation, HybridTable& table, HybridTable& scratch) {
+	switch(operation.code){
+	case GET:
+		return table.get(operation.index);
+	case SET:
+		table.set(operation.index, operation.val);
+		return 0;
+	case COPY: {
+		HybridTable copy(table);
+		return copy.getArraySize();
+	}
+	default:
+		scratch = table;
+		return scratch.getArraySize();
+	}
+}
+
+// same on a shared table; scratch belongs to the calling thread
+static inline long long runOperation(const Operation& operation, ConcurrentHybridTable& table, HybridTable& scratch) {
+	switch(operation.code){
+	case GET:
+		return table.get(operation.index);
+	case SET:
+		table.set(operation.index, operation.val);
+		return 0;
+	case COPY:
+		return table.copy().getArraySize();
+	default:
+		scratch = table.copy();
+		return scratch.getArraySize();
+	}
+}
+
+// replays the operations of thread part out of parts, timing every one if times is given
+template<typename Table>
+static long long replayPart(const vector<Operation>& trace, Table& table, int part, int parts, ReplayTimes* times) {
+	HybridTable scratch;
+	long long checksum = 0;
+	if(times == nullptr){
+		for(size_t itr = part; itr < trace.size(); itr += parts){
+			checksum += runOperation(trace[itr], table, scratch);
+		}
+		return checksum;
+	}
+	for(size_t itr = part; itr < trace.size(); itr += parts){
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		checksum += runOperation(trace[itr], table, scratch);
+		times->latencies[trace[itr].code].push_back((uint32_t)std::min(nanosecondsSince(start), 4e9));
+	}
+	times->checksum = checksum;
+	return checksum;
+}
+
+// a single thread replay also counts the array part resizes
+static void replayCountingResizes(const vector<Operation>& trace, HybridTable& table, ReplayTimes& times) {
+	HybridTable scratch;
+	int array_size = table.getArraySize();
+	for(const Operation& operation : trace){
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		times.checksum += runOperation(operation, table, scratch);
+		times.latencies[operation.code].push_back((uint32_t)std::min(nanosecondsSince(start), 4e9));
+		if(table.getArraySize() != array_size){
+			array_size = table.getArraySize();
+			times.resizes++;
+		}
+	}
+}
+
+static uint32_t percentile(const vector<uint32_t>& sorted, double fraction) {
+	size_t position = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+	return sorted[position];
+}
+
+static void printReport(const vector<Operation>& trace, double seconds, const vector<ReplayTimes>& times,
+                        const HybridTable& final_table, bool resizes_counted) {
+	cout << trace.size() << " operations in " << fixed << setprecision(3) << seconds << " s, "
+	     << setprecision(0) << trace.size() / seconds << " operations/s" << endl << endl;
+
+	cout << left << setw(8) << "op" << right << setw(12) << "count" << setw(10) << "p50 ns" << setw(10) << "p90 ns"
+	     << setw(10) << "p99 ns" << setw(10) << "p99.9 ns" << setw(12) << "max ns" << endl;
+	for(int code = 0; code < OPERATION_CODES; code++){
+		vector<uint32_t> latencies;
+		for(const ReplayTimes& part : times){
+			latencies.insert(latencies.end(), part.latencies[code].begin(), part.latencies[code].end());
+		}
+		if(latencies.empty()){
+			continue;
+		}
+		sort(latencies.begin(), latencies.end());
+		cout << left << setw(8) << OPERATION_NAMES[code] << right << setw(12) << latencies.size()
+		     << setw(10) << percentile(latencies, 0.5) << setw(10) << percentile(latencies, 0.9)
+		     << setw(10) << percentile(latencies, 0.99) << setw(10) << percentile(latencies, 0.999)
+		     << setw(12) << latencies.back() << endl;
+	}
+	cout << endl;
+
+	if(resizes_counted){
+		cout << "array part resizes: " << times[0].resizes << endl;
+	}
+	HybridTableMemoryUsage usage = final_table.memoryUsage();
+	cout << "final table: array part " << final_table.getArraySize() << " slots, "
+	     << final_table.getTotalSize() - final_table.getArraySize() << " list entries" << endl;
+	cout << "final memory: " << usage.total() << " bytes (array " << usage.array_bytes << ", list "
+	     << usage.sparse_bytes << ", overhead " << usage.overhead_bytes << ")" << endl;
+}
+
+int main(int argc, char** argv) {
+	int threads = 0;
+	string binary_out;
+	string trace_path;
+	for(int itr = 1; itr < argc; itr++){
+		string arg = argv[itr];
+		if((arg == "-t") && (itr + 1 < argc)){
+			threads = atoi(argv[++itr]);
+		}
+		else if((arg == "-w") && (itr + 1 < argc)){
+			binary_out = argv[++itr];
+		}
+		else{
+			trace_path = arg;
+		}
+	}
+	if(trace_path.empty() || (threads < 0)){
+		cerr << "usage: " << argv[0] << " [-t threads] [-w binary_out] trace" << endl;
+		return 2;
+	}
+
+	vector<Operation> trace;
+	if(!loadTrace(trace_path, trace)){
+		return 1;
+	}
+	if(!binary_out.empty() && !writeBinaryTrace(binary_out, trace)){
+		cerr << "can't write " << binary_out << endl;
+		return 1;
+	}
+	if(trace.empty()){
+		cout << "empty trace" << endl;
+		return 0;
+	}
+
+	if(threads == 0){
+		HybridTable table;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		long long checksum = replayPart(trace, table, 0, 1, nullptr);
+		double seconds = nanosecondsSince(start) / 1e9;
+
+		vector<ReplayTimes> times(1);
+		HybridTable timed_table;
+		replayCountingResizes(trace, timed_table, times[0]);
+		if(times[0].checksum != checksum){
+			cerr << "the two replays read different values" << endl;
+		}
+		cout << "single thread replay of " << trace_path << endl;
+		printReport(trace, seconds, times, table, true);
+		return 0;
+	}
+
+	ThreadPool pool(threads);
+	ConcurrentHybridTable table;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	pool.run(threads, [&](int part){
+		replayPart(trace, table, part, threads, (ReplayTimes*)nullptr);
+	});
+	double seconds = nanosecondsSince(start) / 1e9;
+
+	vector<ReplayTimes> times(threads);
+	ConcurrentHybridTable timed_table;
+	pool.run(threads, [&](int part){
+		replayPart(trace, timed_table, part, threads, &times[part]);
+	});
+	cout << threads << " thread replay of " << trace_path << " (resizes are not counted with threads)" << endl;
+	printReport(trace, seconds, times, table.copy(), false);
+	return 0;
+}
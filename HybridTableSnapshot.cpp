@@ -0,0 +1,100 @@
+#include "HybridTableSnapshot.h"
+#include "FrozenHybridTable.h"
+#include <cstring>
+#include <ostream>
+
+using namespace std;
+
+HybridTableSnapshot::HybridTableSnapshot(const int* array, int array_size, const vector<pair<int, int> >& list, ostream& out)
+    : array_(array), array_size_(array_size), list_(list), out_(out) {
+    chunk_count_ = (array_size_ + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunk_states_.reset(new atomic<int>[chunk_count_]);
+    for(int chunk = 0; chunk < chunk_count_; chunk++){
+        chunk_states_[chunk].store(UNTOUCHED, memory_order_relaxed);
+    }
+    saved_chunks_.resize(chunk_count_);
+
+    thread_ = thread(&HybridTableSnapshot::run, this);
+}
+
+HybridTableSnapshot::~HybridTableSnapshot() {
+    wait();
+}
+
+void HybridTableSnapshot::preserveAll() {
+    for(int chunk = 0; chunk < chunk_count_; chunk++){
+        if(chunk_states_[chunk].load(memory_order_acquire) < WRITTEN){
+            preserveChunk(chunk);
+        }
+    }
+}
+
+bool HybridTableSnapshot::isDone() const {
+    return done_.load(memory_order_acquire);
+}
+
+bool HybridTableSnapshot::wait() {
+    if(thread_.joinable()){
+        thread_.join();
+    }
+    return ok_;
+}
+
+void HybridTableSnapshot::preserveChunk(int chunk) {
+    int state = UNTOUCHED;
+    if(chunk_states_[chunk].compare_exchange_strong(state, CLAIMED, memory_order_acq_rel)){
+        const int* begin = array_ + (size_t)chunk * CHUNK_SIZE;
+        saved_chunks_[chunk].assign(begin, begin + chunkLength(chunk));
+        chunk_states_[chunk].store(SAVED, memory_order_release);
+        return;
+    }
+
+    // the thread is copying it right now, which takes one chunk copy
+    while(chunk_states_[chunk].load(memory_order_acquire) == CLAIMED){
+        this_thread::yield();
+    }
+}
+
+int HybridTableSnapshot::chunkLength(int chunk) const {
+    int chunk_lo = chunk * CHUNK_SIZE;
+    return (array_size_ - chunk_lo < CHUNK_SIZE) ? array_size_ - chunk_lo : CHUNK_SIZE;
+}
+
+void HybridTableSnapshot::run() {
+    // the list is small next to the array part, so its frozen form is built here
+    vector<int> indices, values;
+    indices.reserve(list_.size());
+    values.reserve(list_.size());
+    for(const pair<int, int>& entry : list_){
+        indices.push_back(entry.first);
+        values.push_back(entry.second);
+    }
+    FrozenHybridTable frozen_list(nullptr, 0, indices.data(), values.data(), indices.size());
+
+    FrozenHybridTable::writeHeader(out_, array_size_, list_.size());
+
+    // copy each chunk out before writing it, so writers never wait on the stream
+    vector<int> buffer(CHUNK_SIZE);
+    for(int chunk = 0; chunk < chunk_count_; chunk++){
+        int length = chunkLength(chunk);
+        const int* source = buffer.data();
+        int state = UNTOUCHED;
+        if(chunk_states_[chunk].compare_exchange_strong(state, CLAIMED, memory_order_acq_rel)){
+            memcpy(buffer.data(), array_ + (size_t)chunk * CHUNK_SIZE, length * sizeof(int));
+            chunk_states_[chunk].store(WRITTEN, memory_order_release);
+        }
+        else{
+            while(chunk_states_[chunk].load(memory_order_acquire) == CLAIMED){
+                this_thread::yield();
+            }
+            source = saved_chunks_[chunk].data();
+        }
+        out_.write((const char*)source, length * sizeof(int));
+        vector<int>().swap(saved_chunks_[chunk]);   // no longer needed (a no-op if it was never saved)
+    }
+
+    frozen_list.writeList(out_);
+    out_.flush();
+    ok_ = out_.good();
+    done_.store(true, memory_order_release);
+}
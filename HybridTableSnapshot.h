@@ -0,0 +1,87 @@
+#ifndef HYBRIDTABLESNAPSHOT_H_
+#define HYBRIDTABLESNAPSHOT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A point in time image of a HybridTable being written on a background
+// thread, started by HybridTable::startSnapshot(). The list part is copied
+// when the snapshot starts. The array part is split into chunks of
+// CHUNK_SIZE slots that the thread copies out one at a time; before the
+// table writes a slot of a chunk the thread has not reached, it copies
+// that chunk aside (copy on write), so the thread still sees the old
+// values and the writer only ever waits for one chunk copy.
+class HybridTableSnapshot {
+
+public:
+	static constexpr int CHUNK_SHIFT = 12;
+	static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+
+	// Starts writing array (array_size slots) and list (sorted by index) to
+	// out, in the FrozenHybridTable::serialize() format. array must stay
+	// valid until preserveAll() or wait() was called.
+	HybridTableSnapshot(const int* array, int array_size, const std::vector<std::pair<int, int> >& list, std::ostream& out);
+
+	// Waits for the thread.
+	~HybridTableSnapshot();
+
+	HybridTableSnapshot(const HybridTableSnapshot&) = delete;
+	HybridTableSnapshot& operator=(const HybridTableSnapshot&) = delete;
+
+	// Must be called before array[i] changes. Slots past the array part
+	// the snapshot started with (it may have grown since) don't matter.
+	void beforeArrayWrite(int i) {
+		if((i < array_size_) && (chunk_states_[i >> CHUNK_SHIFT].load(std::memory_order_acquire) < WRITTEN)){
+			preserveChunk(i >> CHUNK_SHIFT);
+		}
+	}
+
+	// Must be called before the array moves, is freed or changes in bulk;
+	// copies every chunk the thread has not reached yet.
+	void preserveAll();
+
+	// Returns true once the thread has written everything.
+	bool isDone() const;
+
+	// Waits for the thread. Returns false if writing to out failed.
+	bool wait();
+
+private:
+
+	// chunk states, in the order they go through
+	enum ChunkState {
+		UNTOUCHED = 0, // nobody copied it yet
+		CLAIMED = 1,   // the thread or a writer is copying it
+		WRITTEN = 2,   // the thread copied it from the array, writers are free
+		SAVED = 3      // a writer copied it to saved_chunks_, writers are free
+	};
+
+	const int* array_;
+	int array_size_;
+	std::vector<std::pair<int, int> > list_;
+	std::ostream& out_;
+
+	std::unique_ptr<std::atomic<int>[]> chunk_states_;
+	std::vector<std::vector<int> > saved_chunks_; // copies made by writers, freed once written out
+	int chunk_count_;
+
+	std::atomic<bool> done_{false};
+	bool ok_ = true;
+	std::thread thread_;
+
+	// copies a chunk aside unless the thread already has it, waiting out a copy in progress
+	void preserveChunk(int chunk);
+
+	// slots of a chunk (the last one may be short)
+	int chunkLength(int chunk) const;
+
+	// writes the whole image
+	void run();
+};
+
+#endif /* HYBRIDTABLESNAPSHOT_H_ */
@@ -1,7 +1,24 @@
 #include <iostream>
+#include <algorithm>
 #include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory_resource>
+#include <random>
+#include <sstream>
+#include <thread>
 #include "HybridTableTester.h"
 #include "HybridTable.h"
+#include "FrozenHybridTable.h"
+#include "HybridTableJournal.h"
+#include "ThreadPool.h"
+#include "ConcurrentHybridTable.h"
+#include "HybridTableWriter.h"
+#include "VersionedHybridTable.h"
+#include "StaticHybridTable.h"
+#include "CompressedHybridTable.h"
+#include "HybridMatrix.h"
 
 using namespace std;
 
@@ -948,6 +965,1477 @@ void HybridTableTester::testz() {
 	passOut_();
 }
 
+// memoryUsage, compact and expanding back on set
+void HybridTableTester::testA() {
+	funcname_ = "HybridTableTester::testA";
+	{
+
+	HybridTable t;
+	t.set(-5,-5); t.set(100,1); t.set(101,-2); t.set(5000,INT_MIN); t.set(INT_MAX,INT_MAX);
+	const std::string before = t.toString();
+	const HybridTableMemoryUsage node_usage = t.memoryUsage();
+	if (node_usage.array_bytes != HybridTable::INITIAL_ARRAY_SIZE * sizeof(int))
+		errorOut_("wrong array bytes: ", (int)node_usage.array_bytes, 1);
+
+	t.compact();
+	if (!t.isCompact()) errorOut_("not compact after compact()", 1);
+	if (t.toString() != before)
+		errorOut_("compact wrong tostring:\n", t.toString(), 1);
+	if (t.get(101) != -2) errorOut_("compact get101 wrong: ", t.get(101), 1);
+	if (t.get(5000) != INT_MIN) errorOut_("compact get5000 wrong: ", t.get(5000), 1);
+	if (t.get(INT_MAX) != INT_MAX) errorOut_("compact getmax wrong: ", t.get(INT_MAX), 1);
+	if (t.get(102) != 0) errorOut_("compact get102 wrong: ", t.get(102), 1);
+	if (t.getTotalSize() != HybridTable::INITIAL_ARRAY_SIZE + 5)
+		errorOut_("compact wrong totalsize: ", t.getTotalSize(), 1);
+	if (t.memoryUsage().sparse_bytes >= node_usage.sparse_bytes / 2)
+		errorOut_("compact too large: ", (int)t.memoryUsage().sparse_bytes, 1);
+
+	// copies keep the compact form, sets expand it again
+	HybridTable u(t);
+	if (u.toString() != before)
+		errorOut_("copy of compact wrong tostring:\n", u.toString(), 2);
+	t.set(1,1);
+	if (!t.isCompact()) errorOut_("array set expanded the list", 2);
+	t.set(102,3);
+	if (t.isCompact()) errorOut_("list set did not expand the list", 2);
+	if (t.get(102) != 3 || t.get(101) != -2)
+		errorOut_("after expand wrong get: ", t.get(102), 2);
+	if (t.getTotalSize() != HybridTable::INITIAL_ARRAY_SIZE + 6)
+		errorOut_("after expand wrong totalsize: ", t.getTotalSize(), 2);
+
+	}
+	passOut_();
+}
+
+// small tables stay inside the object; spilling to the heap and back
+void HybridTableTester::testB() {
+	funcname_ = "HybridTableTester::testB";
+	{
+
+	HybridTable t;
+	for(int i = 0; i < HybridTable::INLINE_NODE_COUNT; i++) t.set(100+i, i);
+	if (t.memoryUsage().total() != sizeof(HybridTable))
+		errorOut_("small table used heap: ", (int)t.memoryUsage().total(), 1);
+	if (t.memoryUsage().sparse_bytes != HybridTable::INLINE_NODE_COUNT * sizeof(Node))
+		errorOut_("wrong sparse bytes: ", (int)t.memoryUsage().sparse_bytes, 1);
+
+	// nodes past the inline ones cost their heap blocks and nothing else,
+	// however long the list gets
+	HybridTable spilled;
+	for(int i = 0; i < 100; i++) spilled.set(1000 + 10 * i, i);
+	if (spilled.memoryUsage().total() > sizeof(HybridTable) + (100 - HybridTable::INLINE_NODE_COUNT) * 2 * sizeof(Node))
+		errorOut_("long list used more than its nodes: ", (int)spilled.memoryUsage().total(), 1);
+
+	// besides the inline buffers the object is a few words and the saved
+	// growth scan; a policy or an optional index lives on the heap and is
+	// counted there
+	if (sizeof(HybridTable) > HybridTable::INITIAL_ARRAY_SIZE * sizeof(int) + HybridTable::INLINE_NODE_COUNT * sizeof(Node) + 14 * sizeof(void*))
+		errorOut_("object too large: ", (int)sizeof(HybridTable), 1);
+	HybridTable with_policy;
+	with_policy.setPolicy(HybridTablePolicy());
+	if (with_policy.memoryUsage().total() <= sizeof(HybridTable))
+		errorOut_("policy not counted: ", (int)with_policy.memoryUsage().total(), 1);
+
+	// param ctor with a small array is inline too
+	const int a[] = {1,2};
+	HybridTable u(a, 2);
+	u.set(4,4);
+	if (u.memoryUsage().total() != sizeof(HybridTable))
+		errorOut_("small param table used heap: ", (int)u.memoryUsage().total(), 1);
+	// grows 2 -> 4 in place, then 8 on the heap
+	u.set(2,2); u.set(3,3);
+	if (u.toString() != "0 : 1\n1 : 2\n2 : 2\n3 : 3\n---\n4 : 4")
+		errorOut_("inline resize wrong tostring:\n", u.toString(), 1);
+	u.set(5,5); u.set(7,7);
+	if (u.toString() != "0 : 1\n1 : 2\n2 : 2\n3 : 3\n4 : 4\n5 : 5\n6 : 0\n7 : 7")
+		errorOut_("heap resize wrong tostring:\n", u.toString(), 1);
+
+	// spill past the inline nodes, then free some inline slots and reuse them
+	for(int i = 0; i < 10; i++) t.set(200+i, -i);
+	HybridTable v(t);
+	t.set(4,4); t.set(5,5); t.set(6,6); t.set(7,7);
+	for(int i = 0; i < 3; i++) t.set(50+i, i);
+	for(int i = 0; i < 10; i++)
+		if (t.get(200+i) != -i || v.get(200+i) != -i)
+			errorOut_("wrong get after spill: ", t.get(200+i), 2);
+	for(int i = 0; i < 3; i++)
+		if (t.get(50+i) != i)
+			errorOut_("wrong get after reusing inline nodes: ", t.get(50+i), 2);
+	v = t;
+	if (v.toString() != t.toString())
+		errorOut_("wrong assignment:\n", v.toString(), 2);
+	v = u;
+	if (v.toString() != u.toString())
+		errorOut_("wrong assignment from heap array:\n", v.toString(), 2);
+
+	}
+	passOut_();
+}
+
+// growth policy: density, growth factor, cap; sizes past 64
+void HybridTableTester::testC() {
+	funcname_ = "HybridTableTester::testC";
+	{
+
+	// 64 -> 128 (the next power of 2, not 256)
+	int a[64] = {0};
+	HybridTable t(a, 64);
+	for(int i = 64; i < 95; i++) t.set(i,i);
+	if (t.getArraySize() != 64)
+		errorOut_("after set94 wrong size: ", t.getArraySize(), 1);
+	t.set(95,95);
+	if (t.getArraySize() != 128)
+		errorOut_("after set95 wrong size: ", t.getArraySize(), 1);
+
+	// stricter density
+	HybridTable u;
+	HybridTablePolicy strict;
+	strict.density_percent = 100;
+	u.setPolicy(strict);
+	for(int i = 4; i < 7; i++) u.set(i,i);
+	if (u.getArraySize() != HybridTable::INITIAL_ARRAY_SIZE)
+		errorOut_("strict wrong size: ", u.getArraySize(), 1);
+	u.set(7,7);
+	if (u.getArraySize() != 2*HybridTable::INITIAL_ARRAY_SIZE)
+		errorOut_("strict after set7 wrong size: ", u.getArraySize(), 1);
+
+	// x4 growth: candidates are 16, 64, ...
+	HybridTable v;
+	HybridTablePolicy fast;
+	fast.growth_shift = 2;
+	v.setPolicy(fast);
+	for(int i = 4; i < 11; i++) v.set(i,i);
+	if (v.getArraySize() != HybridTable::INITIAL_ARRAY_SIZE)
+		errorOut_("x4 after set10 wrong size: ", v.getArraySize(), 2);
+	v.set(11,11);
+	if (v.getArraySize() != 4*HybridTable::INITIAL_ARRAY_SIZE)
+		errorOut_("x4 after set11 wrong size: ", v.getArraySize(), 2);
+
+	// capped, and the policy is copied along
+	HybridTable w;
+	HybridTablePolicy capped;
+	capped.max_array_size = 8;
+	w.setPolicy(capped);
+	HybridTable w2(w);
+	for(int i = 4; i < 32; i++) w2.set(i,i);
+	if (w2.getArraySize() != 8)
+		errorOut_("capped wrong size: ", w2.getArraySize(), 2);
+	if (w2.getPolicy().max_array_size != 8)
+		errorOut_("policy not copied: ", w2.getPolicy().max_array_size, 2);
+
+	// out of range fields are clamped
+	HybridTablePolicy bad;
+	bad.density_percent = 1000;
+	bad.growth_shift = 0;
+	w.setPolicy(bad);
+	if (w.getPolicy().density_percent != 100 || w.getPolicy().growth_shift != 1)
+		errorOut_("policy not clamped: ", w.getPolicy().density_percent, 2);
+
+	}
+	passOut_();
+}
+
+// presence bitmap: live size, iteration, occupancy based resizing
+void HybridTableTester::testD() {
+	funcname_ = "HybridTableTester::testD";
+	{
+
+	HybridTable t;
+	if (t.getLiveSize() != HybridTable::INITIAL_ARRAY_SIZE)
+		errorOut_("no bitmap wrong livesize: ", t.getLiveSize(), 1);
+	t.enablePresenceBitmap();
+	if (!t.hasPresenceBitmap()) errorOut_("bitmap not enabled", 1);
+	if (t.getLiveSize() != 0)
+		errorOut_("empty wrong livesize: ", t.getLiveSize(), 1);
+	t.set(2,0); t.set(100,7); t.set(-3,-3);
+	if (t.getLiveSize() != 3)
+		errorOut_("wrong livesize: ", t.getLiveSize(), 1);
+	if (t.getTotalSize() != HybridTable::INITIAL_ARRAY_SIZE + 2)
+		errorOut_("wrong totalsize: ", t.getTotalSize(), 1);
+
+	std::string visited;
+	t.forEach([&](int index, int val) { visited += std::to_string(index) + "=" + std::to_string(val) + " "; });
+	if (visited != "2=0 -3=-3 100=7 ")
+		errorOut_("wrong foreach: ", visited, 1);
+
+	// only real entries count towards the 75%: 4..9 are 6 of 16
+	HybridTable u;
+	u.enablePresenceBitmap();
+	for(int i = 4; i < 10; i++) u.set(i,i);
+	if (u.getArraySize() != HybridTable::INITIAL_ARRAY_SIZE)
+		errorOut_("resized on unset slots: ", u.getArraySize(), 2);
+	// array sets don't resize; the next list insert sees 0..2 + 4..10 = 10 of 16, 7 of 8
+	for(int i = 0; i < 3; i++) u.set(i,i);
+	u.set(10,10);
+	if (u.getArraySize() != 8)
+		errorOut_("wrong size after set10: ", u.getArraySize(), 2);
+	u.set(11,11);
+	if (u.getArraySize() != 8)
+		errorOut_("wrong size after set11: ", u.getArraySize(), 2);
+	u.set(12,12);
+	if (u.getArraySize() != 16)
+		errorOut_("wrong size after set12: ", u.getArraySize(), 2);
+
+	// copies keep the bitmap; iteration skips unset words
+	u.set(200,1); u.set(120,1);
+	HybridTable v(u);
+	if (v.getLiveSize() != 14)
+		errorOut_("copy wrong livesize: ", v.getLiveSize(), 2);
+	int count = 0;
+	v.forEach([&](int, int) { count++; });
+	if (count != 14)
+		errorOut_("copy wrong foreach count: ", count, 2);
+
+	// without the bitmap every slot is visited
+	HybridTable w;
+	count = 0;
+	w.forEach([&](int, int) { count++; });
+	if (count != HybridTable::INITIAL_ARRAY_SIZE)
+		errorOut_("no bitmap wrong foreach count: ", count, 2);
+
+	// the bitmap shows up in memoryUsage, one bit per slot
+	vector<int> slots(1 << 20, 1);
+	HybridTable big(slots.data(), (int)slots.size());
+	size_t before_bitmap = big.memoryUsage().total();
+	big.enablePresenceBitmap();
+	if (big.memoryUsage().total() < before_bitmap + slots.size() / 8)
+		errorOut_("bitmap not counted: ", (int)(big.memoryUsage().total() - before_bitmap), 2);
+
+	}
+	passOut_();
+}
+
+// sum/min/max/countNonZero against a get() loop
+void HybridTableTester::testE() {
+	funcname_ = "HybridTableTester::testE";
+	{
+
+	int a[37];
+	for(int i = 0; i < 37; i++) a[i] = (i % 5 == 0) ? 0 : (i * 7919) % 101 - 50;
+	HybridTable t(a, 37);
+	t.set(-10,-1000); t.set(-2,5); t.set(40,1000); t.set(41,0); t.set(60,-3);
+
+	const int bounds[] = {-20, -10, -3, -2, 0, 1, 7, 8, 13, 36, 37, 38, 40, 41, 42, 61, 100};
+	for(int lo : bounds) {
+		for(int hi : bounds) {
+			long long sum = 0;
+			int mn = 0, mx = 0, nonzero = 0;
+			for(int i = lo; i < hi; i++) {
+				int val = t.get(i);
+				sum += val;
+				mn = (i == lo || val < mn) ? val : mn;
+				mx = (i == lo || val > mx) ? val : mx;
+				nonzero += (val != 0);
+			}
+			std::string range = "[" + std::to_string(lo) + "," + std::to_string(hi) + ") ";
+			if (t.sum(lo, hi) != sum) errorOut_(range + "wrong sum: ", (int)t.sum(lo, hi), 1);
+			if (t.min(lo, hi) != mn) errorOut_(range + "wrong min: ", t.min(lo, hi), 1);
+			if (t.max(lo, hi) != mx) errorOut_(range + "wrong max: ", t.max(lo, hi), 1);
+			if (t.countNonZero(lo, hi) != nonzero) errorOut_(range + "wrong count: ", t.countNonZero(lo, hi), 1);
+		}
+	}
+
+	// whole int range, no overflow; same on the compact list
+	HybridTable u;
+	u.set(INT_MIN, INT_MAX); u.set(INT_MAX - 1, INT_MAX); u.set(3, INT_MAX);
+	u.compact();
+	if (u.sum(INT_MIN, INT_MAX) != 3LL * INT_MAX)
+		errorOut_("wrong full range sum", 2);
+	if (u.min(INT_MIN, INT_MAX) != 0) errorOut_("wrong full range min: ", u.min(INT_MIN, INT_MAX), 2);
+	if (u.max(INT_MIN, INT_MAX) != INT_MAX) errorOut_("wrong full range max: ", u.max(INT_MIN, INT_MAX), 2);
+	if (u.min(INT_MIN, INT_MIN + 1) != INT_MAX) errorOut_("wrong single min: ", u.min(INT_MIN, INT_MIN + 1), 2);
+	if (u.countNonZero(INT_MIN, INT_MAX) != 3)
+		errorOut_("wrong full range count: ", u.countNonZero(INT_MIN, INT_MAX), 2);
+
+	}
+	passOut_();
+}
+
+// prefixSum/rangeSum kept current through sets, resizes and copies
+void HybridTableTester::testF() {
+	funcname_ = "HybridTableTester::testF";
+	{
+
+	HybridTable t;
+	t.set(-7,3); t.set(2,5); t.set(50,-4);
+	if (t.prefixSum(INT_MAX) != 4) errorOut_("no index wrong prefixsum: ", (int)t.prefixSum(INT_MAX), 1);
+	t.enablePrefixIndex();
+	if (!t.hasPrefixIndex()) errorOut_("index not enabled", 1);
+
+	// mix of array updates, list inserts, list updates and resizes
+	const int bounds[] = {INT_MIN, -8, -7, 0, 2, 3, 9, 20, 50, 51, 200, INT_MAX};
+	for(int step = 0; step < 60; step++) {
+		int index = (step * 37) % 71 - 10;
+		t.set(index, step - 30);
+		if (step % 3 == 0) t.set(index, step);
+		for(int lo : bounds) {
+			for(int hi : bounds) {
+				if (t.rangeSum(lo, hi) != t.sum(lo, hi))
+					errorOut_("step " + std::to_string(step) + " wrong rangesum: ", (int)t.rangeSum(lo, hi), 1);
+			}
+		}
+	}
+	if (t.getArraySize() < 16)
+		errorOut_("test did not resize: ", t.getArraySize(), 1);
+
+	// copies and compact lists keep working
+	HybridTable u;
+	u = t;
+	u.compact();
+	u.set(1000,1);
+	for(int hi : bounds)
+		if (u.prefixSum(hi) != u.sum(INT_MIN, hi))
+			errorOut_("copy wrong prefixsum: ", (int)u.prefixSum(hi), 2);
+	if (u.prefixSum(INT_MIN) != 0)
+		errorOut_("wrong empty prefixsum: ", (int)u.prefixSum(INT_MIN), 2);
+
+	// the Fenwick tree over the array part shows up in memoryUsage, 8 bytes per slot
+	vector<int> slots(1 << 20, 1);
+	HybridTable big(slots.data(), (int)slots.size());
+	size_t before_index = big.memoryUsage().total();
+	big.enablePrefixIndex();
+	if (big.memoryUsage().total() < before_index + slots.size() * sizeof(long long))
+		errorOut_("prefix index not counted: ", (int)(big.memoryUsage().total() - before_index), 2);
+
+	}
+	passOut_();
+}
+
+// merge with each combiner against get() on both inputs
+void HybridTableTester::testG() {
+	funcname_ = "HybridTableTester::testG";
+	{
+
+	int a[20], b[9];
+	for(int i = 0; i < 20; i++) a[i] = i * 3 - 20;
+	for(int i = 0; i < 9; i++) b[i] = 40 - i * 9;
+	HybridTable t(a, 20), u(b, 9);
+	t.set(-5,1); t.set(30,2); t.set(100,3);
+	u.set(-5,10); u.set(-1,11); u.set(25,12); u.set(100,-13); u.set(500,14);
+	u.compact();
+
+	const MergeCombiner combiners[] = {MergeCombiner::OVERWRITE, MergeCombiner::ADD, MergeCombiner::MAX, MergeCombiner::MIN};
+	for(MergeCombiner combiner : combiners) {
+		HybridTable m(t);
+		m.merge(u, combiner);
+		for(int i = -10; i <= 510; i++) {
+			int mine = t.get(i), theirs = u.get(i), expected;
+			bool in_t = (i >= 0 && i < 20) || i == -5 || i == 30 || i == 100;
+			bool in_u = (i >= 0 && i < 9) || i == -5 || i == -1 || i == 25 || i == 100 || i == 500;
+			if (!in_u) expected = mine;
+			else if (!in_t) expected = theirs;
+			else if (combiner == MergeCombiner::ADD) expected = mine + theirs;
+			else if (combiner == MergeCombiner::MAX) expected = std::max(mine, theirs);
+			else if (combiner == MergeCombiner::MIN) expected = std::min(mine, theirs);
+			else expected = theirs;
+			if (m.get(i) != expected)
+				errorOut_("wrong merged get" + std::to_string(i) + ": ", m.get(i), 1);
+		}
+		if (m.getTotalSize() != 20 + 6)
+			errorOut_("wrong merged totalsize: ", m.getTotalSize(), 1);
+	}
+
+	// the array size is picked from both lists together: neither list resized
+	// on its own, but together 5, 6 and 8..13 fill 12 of [0..15]
+	HybridTable v, w;
+	v.set(5,5); v.set(8,8); v.set(10,10); v.set(12,12);
+	w.set(6,6); w.set(9,9); w.set(11,11); w.set(13,13); w.set(64,64);
+	if (v.getArraySize() != 4 || w.getArraySize() != 4)
+		errorOut_("inputs resized on their own: ", v.getArraySize(), 2);
+	v.merge(w, MergeCombiner::OVERWRITE);
+	if (v.toString() != "0 : 0\n1 : 0\n2 : 0\n3 : 0\n4 : 0\n5 : 5\n6 : 6\n7 : 0\n8 : 8\n9 : 9\n10 : 10\n11 : 11\n12 : 12\n13 : 13\n14 : 0\n15 : 0\n---\n64 : 64")
+		errorOut_("wrong merged tostring:\n", v.toString(), 2);
+
+	// a larger array part on the other side grows this one
+	HybridTable x;
+	x.set(12,1); x.set(-3,-3);
+	x.merge(t, MergeCombiner::ADD);
+	if (x.getArraySize() != 20 || x.get(12) != a[12] + 1 || x.get(-3) != -3)
+		errorOut_("wrong merge into smaller array: ", x.getArraySize(), 2);
+
+	// merging with itself
+	x.merge(x, MergeCombiner::ADD);
+	if (x.get(12) != 2 * (a[12] + 1) || x.get(-5) != 2)
+		errorOut_("wrong self merge: ", x.get(12), 2);
+
+	// unset array slots of a plain source count as 0, with the bitmap they are skipped
+	HybridTable target, plain_source, set_only;
+	target.set(0,84); target.set(3,60);
+	plain_source.set(2,50);
+	set_only.enablePresenceBitmap();
+	set_only.set(2,50);
+	HybridTable from_plain(target), from_set_only(target);
+	from_plain.merge(plain_source, MergeCombiner::OVERWRITE);
+	from_set_only.merge(set_only, MergeCombiner::OVERWRITE);
+	if (from_plain.toString() != "0 : 0\n1 : 0\n2 : 50\n3 : 0")
+		errorOut_("plain source slots not merged as 0:\n", from_plain.toString(), 2);
+	if (from_set_only.toString() != "0 : 84\n1 : 0\n2 : 50\n3 : 60")
+		errorOut_("bitmap source overwrote unset slots:\n", from_set_only.toString(), 2);
+
+	}
+	passOut_();
+}
+
+// bulkLoad serial and on a pool, merge on a pool
+void HybridTableTester::testH() {
+	funcname_ = "HybridTableTester::testH";
+	{
+
+	// small: last value wins, 4..7 fill [0..7]
+	const std::pair<int,int> small[] = {{5,1},{4,2},{100,3},{6,3},{7,4},{-1,6},{5,9}};
+	HybridTable t;
+	t.set(50,50);
+	t.bulkLoad(small, 7);
+	if (t.toString() != "0 : 0\n1 : 0\n2 : 0\n3 : 0\n4 : 2\n5 : 9\n6 : 3\n7 : 4\n---\n-1 : 6 --> 100 : 3")
+		errorOut_("small bulkload wrong tostring:\n", t.toString(), 1);
+	t.bulkLoad(small, 0);
+	if (t.toString() != "0 : 0\n1 : 0\n2 : 0\n3 : 0")
+		errorOut_("empty bulkload wrong tostring:\n", t.toString(), 1);
+
+	// large enough to be split: a dense block, scattered entries and repeats
+	std::vector<std::pair<int,int>> entries;
+	for(int i = 0; i < 150000; i++) entries.push_back(std::make_pair((i * 7) % 150000, i));
+	for(int i = 0; i < 50000; i++) entries.push_back(std::make_pair((int)((long long)((i * 2654435761u) % 4000000000u) - 2000000000), i));
+	entries.push_back(std::make_pair(INT_MIN, 1));
+	entries.push_back(std::make_pair(INT_MAX, 2));
+	for(int i = 0; i < 1000; i++) entries.push_back(std::make_pair(i * 3, -i));
+
+	ThreadPool pool(4);
+	HybridTable serial, parallel;
+	serial.bulkLoad(entries.data(), entries.size());
+	parallel.bulkLoad(entries.data(), entries.size(), &pool);
+	if (serial.getArraySize() != 131072)
+		errorOut_("bulkload wrong arraysize: ", serial.getArraySize(), 2);
+	if (parallel.toString() != serial.toString())
+		errorOut_("parallel bulkload differs from serial", 2);
+	for(size_t i = entries.size() - 1000; i < entries.size(); i++)
+		if (parallel.get(entries[i].first) != entries[i].second)
+			errorOut_("bulkload repeated index wrong: ", parallel.get(entries[i].first), 2);
+	if (parallel.get(INT_MIN) != 1 || parallel.get(INT_MAX) != 2)
+		errorOut_("bulkload extreme indices wrong", 2);
+
+	// merge with the array part split over the pool
+	HybridTable m1(serial), m2(serial);
+	m1.merge(parallel, MergeCombiner::ADD);
+	m2.merge(parallel, MergeCombiner::ADD, &pool);
+	if (m1.toString() != m2.toString())
+		errorOut_("parallel merge differs from serial", 2);
+
+	}
+	passOut_();
+}
+
+// finger and hints give the same tables as plain set
+void HybridTableTester::testI() {
+	funcname_ = "HybridTableTester::testI";
+	{
+
+	// increasing, decreasing and jumping back, with lookups in between
+	HybridTable t, u;
+	HybridTable::Hint hint;
+	const int indices[] = {100, 101, 103, 102, 50, 51, 200, -5, 104, 6, 7, 5, 8, 300, 299, 9, 10, 11, 12};
+	for(int index : indices) {
+		t.set(index, index * 2);
+		hint = u.set(hint, index, index * 2);
+		if (t.get(index - 1) != u.get(index - 1))
+			errorOut_("hinted lookup wrong: ", u.get(index - 1), 1);
+	}
+	if (t.toString() != u.toString())
+		errorOut_("hinted sets wrong tostring:\n", u.toString(), 1);
+	for(int i = -10; i < 310; i++)
+		if (u.get(i) != t.get(i))
+			errorOut_("hinted get wrong at ", i, 1);
+
+	// hints from another table, or from before nodes were freed, are ignored
+	HybridTable v;
+	HybridTable::Hint other_table = t.set(HybridTable::Hint(), 1000, 1);
+	v.set(other_table, 999, 1);
+	HybridTable::Hint before_resize = v.set(HybridTable::Hint(), 5, 5);
+	v.set(6,6); v.set(7,7);   // resize frees the nodes
+	v.set(before_resize, 4, 4);
+	if (v.toString() != "0 : 0\n1 : 0\n2 : 0\n3 : 0\n4 : 4\n5 : 5\n6 : 6\n7 : 7\n---\n999 : 1")
+		errorOut_("stale hint wrong tostring:\n", v.toString(), 2);
+
+	// long append run past the array part
+	HybridTable w;
+	hint = HybridTable::Hint();
+	for(int i = 0; i < 2000; i++) hint = w.set(hint, 1000000 + 7 * i, i);
+	for(int i = 0; i < 2000; i++)
+		if (w.get(1000000 + 7 * i) != i)
+			errorOut_("append run wrong get: ", w.get(1000000 + 7 * i), 2);
+	if (w.getTotalSize() != HybridTable::INITIAL_ARRAY_SIZE + 2000)
+		errorOut_("append run wrong totalsize: ", w.getTotalSize(), 2);
+
+	// a resumed scan picks the same array size as a full rescan, which a
+	// fresh copy always does on its next set; mostly appends, with some
+	// jumps, inserts further back and array writes (which the bitmap counts)
+	int resizes = 0;
+	for(int seed = 0; seed < 8; seed++) {
+		mt19937 rng(seed);
+		HybridTable resumed, with_bitmap;
+		with_bitmap.enablePresenceBitmap();
+		HybridTable::Hint resumed_hint, bitmap_hint;
+		int next_index = HybridTable::INITIAL_ARRAY_SIZE - 1;
+		for(int step = 0; step < 500; step++) {
+			int index;
+			if (rng() % 10 == 0) index = (int)(rng() % (next_index + 50)) - 50;
+			else index = next_index += (rng() % 256 == 0) ? 1 + (int)(rng() % 200) : 1;
+			HybridTable fresh(resumed), bitmap_fresh(with_bitmap);
+			int old_size = resumed.getArraySize();
+			resumed_hint = resumed.set(resumed_hint, index, step);
+			bitmap_hint = with_bitmap.set(bitmap_hint, index, step);
+			fresh.set(index, step);
+			bitmap_fresh.set(index, step);
+			if (resumed.getArraySize() != fresh.getArraySize() || !(resumed == fresh))
+				errorOut_("resumed scan differs from a rescan, seed ", seed, 2);
+			if (with_bitmap.getArraySize() != bitmap_fresh.getArraySize() || !(with_bitmap == bitmap_fresh))
+				errorOut_("resumed scan with bitmap differs from a rescan, seed ", seed, 2);
+			resizes += resumed.getArraySize() != old_size;
+		}
+	}
+	if (resizes < 8 * 3)
+		errorOut_("sequences resized too rarely to check the rule: ", resizes, 2);
+
+	}
+	passOut_();
+}
+
+// list filter never hides an entry, through inserts, resizes, merges, copies
+void HybridTableTester::testJ() {
+	funcname_ = "HybridTableTester::testJ";
+	{
+
+	HybridTable t, plain;
+	t.enableListFilter();
+	if (!t.hasListFilter()) errorOut_("filter not enabled", 1);
+	for(int i = 0; i < 3000; i++) {
+		int index = (int)((i * 2654435761u) % 100000u) - 50000;
+		t.set(index, i + 1);
+		plain.set(index, i + 1);
+	}
+	for(int i = -50010; i < 50010; i++)
+		if (t.get(i) != plain.get(i))
+			errorOut_("filtered get wrong at ", i, 1);
+	if (t.toString() != plain.toString())
+		errorOut_("filtered table differs from plain one", 1);
+
+	// filter enabled after the fact, then a resize, a merge and a copy
+	HybridTable u;
+	for(int i = 20; i > 4; i--) u.set(i * 10, i);
+	u.enableListFilter(16);
+	u.set(4,4); u.set(5,5); u.set(6,6);   // resize to 8
+	HybridTable v;
+	v.set(1000,1); v.set(-1000,2);
+	u.merge(v, MergeCombiner::OVERWRITE);
+	HybridTable w(u);
+	for(int i = 20; i > 6; i--)
+		if (w.get(i * 10) != i) errorOut_("copy get wrong: ", w.get(i * 10), 2);
+	if (w.get(1000) != 1 || w.get(-1000) != 2 || w.get(5) != 5 || w.get(999) != 0)
+		errorOut_("after merge wrong get: ", w.get(1000), 2);
+	w.set(999,9);
+	if (w.get(999) != 9) errorOut_("set after copy wrong get: ", w.get(999), 2);
+
+	// new entries on a compacted list the filter has never seen
+	HybridTable c;
+	c.set(100,1); c.set(200,2); c.set(300,3);
+	c.enableListFilter();
+	c.compact();
+	c.set(400,4);
+	if (c.get(400) != 4 || c.isCompact()) errorOut_("set after compact wrong get: ", c.get(400), 2);
+	c.compact();
+	if (c.add(500, 5) != 5 || c.get(500) != 5) errorOut_("add after compact wrong get: ", c.get(500), 2);
+	if (c.toString() != "0 : 0\n1 : 0\n2 : 0\n3 : 0\n---\n100 : 1 --> 200 : 2 --> 300 : 3 --> 400 : 4 --> 500 : 5")
+		errorOut_("after compact printed as:\n", c.toString(), 2);
+
+	// the filter words show up in memoryUsage
+	size_t before_filter = plain.memoryUsage().total();
+	size_t list_length = plain.getTotalSize() - plain.getArraySize();
+	plain.enableListFilter(64);
+	if (plain.memoryUsage().total() < before_filter + list_length * 64 / 8)
+		errorOut_("filter not counted: ", (int)(plain.memoryUsage().total() - before_filter), 2);
+
+	}
+	passOut_();
+}
+
+// freeze: frozen lookups match the table, getMany, ranges, serialize round trip
+void HybridTableTester::testK() {
+	funcname_ = "HybridTableTester::testK";
+	{
+
+	// empty table, table without a list, table with a list of every size up to 40
+	HybridTable e;
+	FrozenHybridTable fe = e.freeze();
+	if (fe.toString() != e.toString()) errorOut_("frozen empty toString: ", fe.toString(), 1);
+	if (fe.get(7) != 0 || fe.get(-7) != 0) errorOut_("frozen empty get wrong", 1);
+
+	for(int n = 0; n <= 40; n++) {
+		HybridTable t;
+		for(int k = 0; k < n; k++) t.set(100 + 3 * k, k + 1);
+		t.set(-5, 42);
+		FrozenHybridTable f = t.freeze();
+		if (f.toString() != t.toString()) errorOut_("frozen toString differs: ", f.toString(), 2);
+		if (f.getTotalSize() != t.getTotalSize()) errorOut_("frozen total size: ", f.getTotalSize(), 2);
+		for(int i = -10; i < 100 + 3 * n + 10; i++)
+			if (f.get(i) != t.get(i)) errorOut_("frozen get wrong at ", i, 2);
+	}
+
+	// getMany and range iteration
+	HybridTable t;
+	for(int i = 0; i < 4; i++) t.set(i, i + 10);
+	t.set(-20, 1); t.set(-3, 2); t.set(50, 3); t.set(70, 4); t.set(INT_MAX, 5);
+	FrozenHybridTable f = t.freeze();
+	int indices[] = {-20, -19, 0, 3, 4, 50, 70, INT_MAX, INT_MIN};
+	int expected[] = {1, 0, 10, 13, 0, 3, 4, 5, 0};
+	int out[9];
+	f.getMany(indices, out, 9);
+	for(int k = 0; k < 9; k++)
+		if (out[k] != expected[k]) errorOut_("getMany wrong at ", k, 3);
+	string visited;
+	f.forEachInRange(-3, 71, [&](int index, int val){ visited += to_string(index) + ":" + to_string(val) + " "; });
+	if (visited != "-3:2 0:10 1:11 2:12 3:13 50:3 70:4 ")
+		errorOut_("range iteration: ", visited, 3);
+	visited.clear();
+	f.forEachInRange(2, 60, [&](int index, int val){ visited += to_string(index) + ":" + to_string(val) + " "; });
+	if (visited != "2:12 3:13 50:3 ")
+		errorOut_("range iteration: ", visited, 3);
+
+	// serialize round trip, then a damaged image
+	stringstream image;
+	f.serialize(image);
+	FrozenHybridTable g;
+	if (!g.deserialize(image)) errorOut_("deserialize failed", 4);
+	if (g.toString() != t.toString()) errorOut_("deserialized toString: ", g.toString(), 4);
+	string bytes;
+	{
+		stringstream again;
+		f.serialize(again);
+		bytes = again.str();
+	}
+	stringstream truncated(bytes.substr(0, bytes.size() - 2));
+	if (g.deserialize(truncated)) errorOut_("truncated image accepted", 4);
+	if (g.getTotalSize() != 0) errorOut_("failed deserialize left entries: ", g.getTotalSize(), 4);
+	// a list size far past the end of the image, then keys out of order or
+	// inside the array part (header, 4 array slots, then the 5 keys)
+	string huge = bytes;
+	unsigned long long huge_size = INT_MAX;
+	memcpy(&huge[4 + sizeof(unsigned long long)], &huge_size, sizeof(huge_size));
+	stringstream huge_image(huge);
+	if (g.deserialize(huge_image)) errorOut_("list size past the image accepted", 4);
+	const size_t keys_at = 4 + 2 * sizeof(unsigned long long) + 4 * sizeof(int);
+	string swapped = bytes;
+	std::swap_ranges(&swapped[keys_at], &swapped[keys_at + sizeof(int)], &swapped[keys_at + sizeof(int)]);
+	stringstream swapped_image(swapped);
+	if (g.deserialize(swapped_image)) errorOut_("keys out of order accepted", 4);
+	string in_array = bytes;
+	int array_key = 2;
+	memcpy(&in_array[keys_at], &array_key, sizeof(array_key));
+	stringstream in_array_image(in_array);
+	if (g.deserialize(in_array_image)) errorOut_("key inside the array part accepted", 4);
+	if (g.getTotalSize() != 0) errorOut_("rejected image left entries: ", g.getTotalSize(), 4);
+	bytes[0] = 'X';
+	stringstream bad_magic(bytes);
+	if (g.deserialize(bad_magic)) errorOut_("bad magic accepted", 4);
+
+	}
+	passOut_();
+}
+
+// journal: replay, a torn batch at the end, compaction, files that are not journals
+void HybridTableTester::testL() {
+	funcname_ = "HybridTableTester::testL";
+	{
+
+	const string path = "HybridTableTester_testL.journal";
+	std::remove(path.c_str());
+	std::remove((path + ".snapshot").c_str());
+
+	HybridTable t;
+	{
+		HybridTableJournalOptions options;
+		options.batch_records = 64;
+		HybridTableJournal journal(path, options);
+		if (!journal.isOpen()) errorOut_("journal not opened", 1);
+		t.attachJournal(&journal);
+		for(int i = 0; i < 500; i++) t.set((i * 37) % 1000 - 200, i + 1);
+		t.set(3, 33);
+		t.attachJournal(nullptr);
+	}   // the destructor writes out what is left
+
+	// replay, then a torn batch at the end
+	{
+		HybridTableJournal journal(path);
+		HybridTable r;
+		if (!journal.replay(r)) errorOut_("replay failed", 2);
+		for(int i = -210; i < 1010; i++)
+			if (r.get(i) != t.get(i)) errorOut_("replayed get wrong at ", i, 2);
+	}
+	{
+		ofstream tail(path, ios::binary | ios::app);
+		tail << "torn";
+	}
+	HybridTableJournal journal(path);
+	HybridTable r;
+	if (!journal.isOpen() || !journal.replay(r)) errorOut_("replay after torn batch failed", 3);
+	if (r.get(3) != 33 || r.get(-200) != 1) errorOut_("replayed get wrong: ", r.get(3), 3);
+
+	// compaction, then more sets on top of the snapshot
+	r.attachJournal(&journal);
+	if (!journal.compact(r)) errorOut_("compact failed", 4);
+	{
+		ifstream log(path, ios::binary | ios::ate);
+		if (log.tellg() != 4) errorOut_("journal not emptied: ", (int)log.tellg(), 4);
+	}
+	r.set(3, 34);
+	r.set(5000, 7);
+	if (!journal.sync()) errorOut_("sync failed", 4);
+	HybridTable s;
+	if (!journal.replay(s)) errorOut_("replay after compact failed", 4);
+	for(int i = -210; i < 1010; i++)
+		if (s.get(i) != r.get(i)) errorOut_("compacted get wrong at ", i, 4);
+	if (s.get(5000) != 7) errorOut_("compacted get wrong: ", s.get(5000), 4);
+	r.attachJournal(nullptr);
+
+	// not a journal
+	const string other = "HybridTableTester_testL.other";
+	{
+		ofstream junk(other, ios::binary);
+		junk << "not a journal";
+	}
+	HybridTableJournal bad(other);
+	if (bad.isOpen()) errorOut_("opened a file that is not a journal", 5);
+	std::remove(other.c_str());
+
+	std::remove(path.c_str());
+	std::remove((path + ".snapshot").c_str());
+	}
+	passOut_();
+}
+
+// background snapshot: the image is the table at the start, whatever writes follow
+void HybridTableTester::testM() {
+	funcname_ = "HybridTableTester::testM";
+	{
+
+	// writes during the snapshot must not show up in it
+	vector<int> values(100000);
+	for(int i = 0; i < 100000; i++) values[i] = i;
+	HybridTable t(values.data(), 100000);
+	t.set(-7, 70); t.set(1 << 20, 80);
+	string before = t.freeze().toString();
+
+	stringstream image;
+	if (!t.startSnapshot(image)) errorOut_("startSnapshot failed", 1);
+	stringstream other;
+	if (t.isSnapshotRunning() && t.startSnapshot(other)) errorOut_("second snapshot started", 1);
+	for(int i = 99999; i >= 0; i -= 3) t.set(i, -i);
+	t.set(-7, 71);
+	t.set(-8, 1);
+	if (!t.finishSnapshot()) errorOut_("finishSnapshot failed", 1);
+	if (t.isSnapshotRunning()) errorOut_("snapshot still running", 1);
+
+	FrozenHybridTable f;
+	if (!f.deserialize(image)) errorOut_("snapshot image not readable", 2);
+	if (f.toString() != before) errorOut_("snapshot is not the table at the start", 2);
+	if (t.get(99999) != -99999 || t.get(-7) != 71) errorOut_("set during snapshot lost: ", t.get(99999), 2);
+
+	// a resize, an assignment and the destructor while a snapshot runs
+	for(int round = 0; round < 3; round++) {
+		HybridTable* u = new HybridTable(values.data(), 20000);
+		u->set(-1, 5);
+		string start = u->freeze().toString();
+		stringstream out;
+		u->startSnapshot(out);
+		if (round == 0) {
+			HybridTable bigger(values.data(), 60000);
+			u->merge(bigger, MergeCombiner::ADD);   // grows the array part
+			u->set(7, 0);
+			u->finishSnapshot();
+		} else if (round == 1) {
+			HybridTable small;
+			small.set(1, 1);
+			*u = small;
+			u->finishSnapshot();
+		}
+		delete u;
+		FrozenHybridTable g;
+		if (!g.deserialize(out) || g.toString() != start)
+			errorOut_("snapshot changed by a resize/assignment/delete, round ", round, 3);
+	}
+
+	}
+	passOut_();
+}
+
+// concurrent table: buffered writers batch and flush, several writer threads
+void HybridTableTester::testN() {
+	funcname_ = "HybridTableTester::testN";
+	{
+
+	// the last set() of an index in a batch wins, unset array slots don't overwrite
+	ConcurrentHybridTable c;
+	c.set(2, 20); c.set(5, 50); c.set(-3, 30);
+	{
+		HybridTableWriter w(c, 100);
+		w.set(5, 1); w.set(9000, 2); w.set(5, 3); w.set(-3, 0); w.set(1, 4);
+		if (w.getPendingCount() != 5) errorOut_("pending count: ", (int)w.getPendingCount(), 1);
+		if (c.get(5) != 50) errorOut_("buffered value visible before flush: ", c.get(5), 1);
+		w.flush();
+		if (w.getPendingCount() != 0) errorOut_("pending after flush: ", (int)w.getPendingCount(), 1);
+		w.set(7, 70);
+	}   // the destructor flushes
+	if (c.get(5) != 3 || c.get(9000) != 2 || c.get(-3) != 0 || c.get(1) != 4 || c.get(2) != 20 || c.get(7) != 70)
+		errorOut_("flushed values wrong: ", c.toString(), 1);
+
+	// several writer threads and a reader, compared with a plain table
+	ConcurrentHybridTable shared;
+	const int threads = 4, per_thread = 1500;
+	vector<thread> workers;
+	for(int t = 0; t < threads; t++) {
+		workers.push_back(thread([&shared, t](){
+			HybridTableWriter w(shared, 256);
+			for(int k = 0; k < per_thread; k++) {
+				int index = (k % 2 == 0) ? t * per_thread + k : -(t * per_thread + k) * 7;
+				w.set(index, k + 1);
+			}
+		}));
+	}
+	thread reader([&shared](){
+		for(int k = 0; k < 2000; k++) shared.get(k * 5);
+	});
+	for(thread& worker : workers) worker.join();
+	reader.join();
+
+	HybridTable expected;
+	for(int t = 0; t < threads; t++)
+		for(int k = 0; k < per_thread; k++)
+			expected.set((k % 2 == 0) ? t * per_thread + k : -(t * per_thread + k) * 7, k + 1);
+	HybridTable result = shared.copy();
+	for(int i = -threads * per_thread * 7; i < threads * per_thread; i++)
+		if (result.get(i) != expected.get(i)) errorOut_("concurrent writers wrong at ", i, 2);
+	int lookups = shared.read([](const HybridTable& t){ return t.getTotalSize(); });
+	if (lookups != shared.getTotalSize()) errorOut_("read() wrong: ", lookups, 2);
+
+	}
+	passOut_();
+}
+
+// add, fetchAdd, exchange, compareExchange, alone and from several threads
+void HybridTableTester::testO() {
+	funcname_ = "HybridTableTester::testO";
+	{
+
+	HybridTable t;
+	t.enablePrefixIndex();
+	t.set(1, 10); t.set(100, 5);
+	if (t.add(1, 5) != 15 || t.get(1) != 15) errorOut_("add on array wrong: ", t.get(1), 1);
+	if (t.fetchAdd(100, -7) != 5 || t.get(100) != -2) errorOut_("fetchAdd on list wrong: ", t.get(100), 1);
+	if (t.fetchAdd(-50, 3) != 0 || t.get(-50) != 3) errorOut_("fetchAdd on missing index wrong: ", t.get(-50), 1);
+	if (t.add(INT_MAX - 2, 0) != 0 || t.getTotalSize() != 7) errorOut_("add 0 on missing index wrong: ", t.getTotalSize(), 1);
+	t.set(2, INT_MAX);
+	if (t.add(2, 1) != INT_MIN) errorOut_("add does not wrap: ", t.get(2), 1);
+	if (t.exchange(100, 9) != -2 || t.get(100) != 9) errorOut_("exchange wrong: ", t.get(100), 2);
+	if (t.exchange(7, 4) != 0 || t.get(7) != 4) errorOut_("exchange on missing index wrong: ", t.get(7), 2);
+	if (t.rangeSum(-100, 200) != 15 + 9 + 3 + INT_MIN + 4LL) errorOut_("prefix index not updated", 2);
+
+	int expected = 8;
+	if (t.compareExchange(100, expected, 1) || expected != 9 || t.get(100) != 9)
+		errorOut_("failed compareExchange wrong: ", expected, 3);
+	if (!t.compareExchange(100, expected, 1) || t.get(100) != 1)
+		errorOut_("compareExchange wrong: ", t.get(100), 3);
+	int total_size = t.getTotalSize();
+	expected = 1;
+	if (t.compareExchange(5000, expected, 2) || expected != 0 || t.getTotalSize() != total_size)
+		errorOut_("failed compareExchange inserted: ", t.getTotalSize(), 3);
+	if (!t.compareExchange(5000, expected, 2) || t.get(5000) != 2)
+		errorOut_("compareExchange on missing index wrong: ", t.get(5000), 3);
+
+	// counters from several threads: atomic in the array part, locked outside
+	ConcurrentHybridTable c(HybridTable(vector<int>(64).data(), 64));
+	const int threads = 4, rounds = 5000;
+	vector<thread> workers;
+	for(int w = 0; w < threads; w++) {
+		workers.push_back(thread([&c](){
+			for(int k = 0; k < rounds; k++) {
+				c.add(k % 63, 1);
+				c.fetchAdd(1000 + k % 8, 2);
+				int seen = c.get(63);
+				while (!c.compareExchange(63, seen, seen + 1)) {}
+			}
+		}));
+	}
+	for(thread& worker : workers) worker.join();
+	long long counted = 0;
+	for(int i = 0; i < 63; i++) counted += c.get(i);
+	if (counted != (long long)threads * rounds) errorOut_("lost atomic adds: ", (int)counted, 4);
+	if (c.get(63) != threads * rounds)
+		errorOut_("lost compareExchange updates: ", c.get(63), 4);
+	for(int i = 1000; i < 1008; i++)
+		if (c.get(i) != threads * rounds / 8 * 2) errorOut_("lost locked adds at ", i, 4);
+	int slot5 = c.get(5);
+	if (c.exchange(5, -1) != slot5 || c.get(5) != -1 || slot5 != threads * ((rounds - 5 + 62) / 63))
+		errorOut_("concurrent exchange wrong: ", c.get(5), 4);
+
+	}
+	passOut_();
+}
+
+// versioned reads: pinned views, batches as one version, no torn reads
+void HybridTableTester::testP() {
+	funcname_ = "HybridTableTester::testP";
+	{
+
+	// a pinned view keeps its version through writes and a resize
+	HybridTable plain;
+	VersionedHybridTable v;
+	VersionedHybridTable::ReadView empty = v.pin();
+	v.set(1, 10); plain.set(1, 10);
+	v.set(-4, 40); plain.set(-4, 40);
+	VersionedHybridTable::ReadView before = v.pin();
+	string before_string = plain.toString();
+	for(int i = 0; i < 20; i++) { v.set(i, i + 100); plain.set(i, i + 100); }   // resizes
+	v.set(-4, 41); plain.set(-4, 41);
+	if (empty.toString() != HybridTable().toString() || empty.getVersion() != 0)
+		errorOut_("empty view changed: ", empty.toString(), 1);
+	if (before.toString() != before_string || before.getVersion() != 2 || before.get(1) != 10)
+		errorOut_("pinned view changed: ", before.toString(), 1);
+	if (v.pin().toString() != plain.toString() || v.getVersion() != 23)
+		errorOut_("latest view wrong: ", v.pin().toString(), 1);
+	if (v.pin().getTotalSize() != plain.getTotalSize()) errorOut_("total size wrong: ", v.pin().getTotalSize(), 1);
+
+	// a batch is one version, repeated indices in it end with the last value
+	pair<int, int> batch[] = {{3, 1}, {900, 2}, {-9, 3}, {900, 4}, {3, 5}, {-4, 6}};
+	v.set(batch, 6);
+	for(const pair<int, int>& entry : batch) plain.set(entry.first, entry.second);
+	if (v.getVersion() != 24 || v.get(900) != 4 || v.get(3) != 5 || v.get(-4) != 6 || v.get(-9) != 3)
+		errorOut_("batch wrong: ", v.pin().toString(), 2);
+	if (v.pin().toString() != plain.toString()) errorOut_("batch differs from plain table: ", v.pin().toString(), 2);
+
+	// a sparse list spans many segments: appends, inserts anywhere and
+	// batches split and copy them, while views pinned on the way stay put
+	mt19937 rng(41);
+	VersionedHybridTable sparse;
+	HybridTable sparse_plain;
+	vector<pair<VersionedHybridTable::ReadView, string> > pinned;
+	int next_append = 1000;
+	for(int step = 0; step < 3000; step++) {
+		if (step % 100 == 99) {
+			vector<pair<int, int> > writes;
+			for(int k = 0; k < 40; k++) writes.push_back({(int)(rng() % 200000) * 31 - 3000000, step + k});
+			writes.push_back(writes[0]);
+			sparse.set(writes.data(), writes.size());
+			for(const pair<int, int>& entry : writes) sparse_plain.set(entry.first, entry.second);
+		}
+		else {
+			int index = (step % 2) ? (next_append += 7) : (int)(rng() % 200000) * 31 - 3000000;
+			sparse.set(index, step);
+			sparse_plain.set(index, step);
+		}
+		if (step % 500 == 0) pinned.push_back({sparse.pin(), sparse_plain.toString()});
+	}
+	if (sparse.pin().toString() != sparse_plain.toString() || sparse.pin().getTotalSize() != sparse_plain.getTotalSize())
+		errorOut_("sparse list differs from plain table, size ", sparse.pin().getTotalSize(), 2);
+	for(int probe = 0; probe < 20000; probe++) {
+		int index = (int)(rng() % 200000) * 31 - 3000000 + (int)(rng() % 2);
+		if (sparse.get(index) != sparse_plain.get(index)) errorOut_("sparse get wrong at ", index, 2);
+	}
+	for(const pair<VersionedHybridTable::ReadView, string>& view : pinned)
+		if (view.first.toString() != view.second) errorOut_("pinned sparse view changed, version ", (int)view.first.getVersion(), 2);
+
+	// readers check that pairs written together are never seen apart
+	VersionedHybridTable shared;
+	atomic<bool> stop(false);
+	atomic<int> torn(0);
+	thread reader([&](){
+		while (!stop.load()) {
+			VersionedHybridTable::ReadView view = shared.pin();
+			for(int i = 0; i < 50; i++)
+				if (view.get(i * 97) != view.get(-i - 1)) torn++;
+		}
+	});
+	for(int round = 1; round <= 300; round++) {
+		pair<int, int> writes[2] = {{(round % 50) * 97, round}, {-(round % 50) - 1, round}};
+		shared.set(writes, 2);
+	}
+	stop.store(true);
+	reader.join();
+	if (torn.load() != 0) errorOut_("torn reads: ", torn.load(), 3);
+
+	}
+	passOut_();
+}
+
+// equality and hash ignore the split between the parts; diff and applyPatch
+void HybridTableTester::testQ() {
+	funcname_ = "HybridTableTester::testQ";
+	{
+
+	// the same contents split differently between the parts
+	HybridTable a, b;
+	for(int i = 0; i < 40; i++) a.set(i, i + 1);
+	a.set(-5, 9); a.set(100, 0);
+	vector<pair<int, int>> entries;
+	for(int i = 39; i >= 0; i--) entries.push_back(make_pair(i, i + 1));
+	entries.push_back(make_pair(-5, 9));
+	entries.push_back(make_pair(-6, 0));
+	b.bulkLoad(entries.data(), entries.size());
+	b.set(1000, 3); b.set(1000, 0);
+	if (!(a == b) || a.hash() != b.hash()) errorOut_("equal tables differ: ", b.toString(), 1);
+	b.set(-5, 8);
+	if (a == b || a.hash() == b.hash()) errorOut_("different tables equal", 1);
+	HybridTable c(a), e1, e2;
+	e2.set(3, 0);
+	if (!(c == a) || !(e1 == e2) || e1.hash() != e2.hash() || e1 == a) errorOut_("copy or empty equality wrong", 1);
+
+	// diff/applyPatch round trips, and the delta follows the changes
+	mt19937 rng(29);
+	for(int round = 0; round < 20; round++) {
+		HybridTable from, to;
+		for(int k = 0; k < 300; k++) {
+			int index = (int)(rng() % 2000) - 500;
+			from.set(index, (int)rng());
+			to.set(index, (int)rng());
+			if (rng() % 2) to.set(index + 7, 0);
+		}
+		if (round == 0) to.set(INT_MAX, 1);
+		if (round == 1) from.set(INT_MIN, 1);
+		vector<unsigned char> delta = HybridTable::diff(from, to);
+		HybridTable patched(from);
+		if (!patched.applyPatch(delta)) errorOut_("applyPatch failed in round ", round, 2);
+		if (!(patched == to) || patched.hash() != to.hash()) errorOut_("patched table differs in round ", round, 2);
+		if (HybridTable::diff(to, patched).size() != 1) errorOut_("diff of equal tables not empty in round ", round, 2);
+	}
+	vector<int> big(100000, 1);
+	HybridTable x(big.data(), 100000), y(x);
+	y.set(5, 2); y.set(99999, 3); y.set(-1, 4);
+	vector<unsigned char> small_delta = HybridTable::diff(x, y);
+	if (small_delta.size() > 16) errorOut_("delta of 3 changes too large: ", (int)small_delta.size(), 3);
+
+	// malformed deltas change nothing
+	HybridTable before(x);
+	vector<unsigned char> truncated(small_delta.begin(), small_delta.end() - 1);
+	vector<unsigned char> trailing(small_delta);
+	trailing.push_back(0);
+	vector<unsigned char> endless(6, 0xff);
+	vector<unsigned char> empty;
+	if (x.applyPatch(truncated) || x.applyPatch(trailing) || x.applyPatch(endless) || x.applyPatch(empty))
+		errorOut_("malformed delta accepted", 4);
+	if (!(x == before)) errorOut_("malformed delta changed the table", 4);
+
+	}
+	passOut_();
+}
+
+// memory resources: every allocation goes through the table's resource
+void HybridTableTester::testR() {
+	funcname_ = "HybridTableTester::testR";
+	{
+
+	// counts what is still allocated from it
+	class CountingResource : public std::pmr::memory_resource {
+	public:
+		long long blocks = 0, bytes = 0, total_blocks = 0;
+	private:
+		void* do_allocate(size_t size, size_t align) override {
+			blocks++; bytes += size; total_blocks++;
+			return std::pmr::new_delete_resource()->allocate(size, align);
+		}
+		void do_deallocate(void* p, size_t size, size_t align) override {
+			blocks--; bytes -= size;
+			std::pmr::new_delete_resource()->deallocate(p, size, align);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	};
+
+	// every allocation goes to the resource and comes back with the right size
+	CountingResource counting;
+	{
+		HybridTable t(&counting);
+		if (t.getResource() != &counting) errorOut_("getResource wrong", 1);
+		for(int i = 0; i < 200; i++) t.set(i * 3, i + 1);
+		for(int i = 0; i < 50; i++) t.set(-i - 1, i);
+		HybridTable copy(t, &counting);
+		copy.compact();
+		if (!(copy == t)) errorOut_("copy wrong: ", copy.toString(), 2);
+		copy.set(-100, 5);
+		vector<pair<int, int>> entries;
+		for(int i = 0; i < 500; i++) entries.push_back(make_pair(i * 7 - 100, i));
+		HybridTable loaded(&counting);
+		loaded.bulkLoad(entries.data(), entries.size());
+		HybridTable assigned(&counting);
+		assigned = loaded;
+		if (assigned.getResource() != &counting || assigned.get(3393) != 499 || loaded.get(-93) != 1)
+			errorOut_("bulkLoad or assignment wrong", 2);
+		if (copy.get(-100) != 5 || copy.get(597) != 200 || t.get(-100) != 0) errorOut_("copy not independent", 2);
+		HybridTable plain(t);
+		if (plain.getResource() != std::pmr::get_default_resource() || !(plain == t))
+			errorOut_("plain copy not on the default resource", 2);
+		if (counting.blocks == 0) errorOut_("nothing allocated from the resource", 2);
+	}
+	if (counting.blocks != 0 || counting.bytes != 0 || counting.total_blocks == 0)
+		errorOut_("allocations not balanced: ", (int)counting.blocks, 3);
+
+	// a monotonic arena without an upstream serves the whole table
+	alignas(std::max_align_t) static unsigned char buffer[1 << 20];
+	std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+	{
+		vector<int> values(1000, 2);
+		HybridTable t(values.data(), 1000, &arena);
+		for(int i = 0; i < 3000; i++) t.set(i * 5, i);
+		for(int i = 0; i < 100; i++) t.set(-i * 11 - 1, i);
+		t.compact();
+		t.set(-5000, 7);
+		if (t.get(14995) != 2999 || t.get(1) != 2 || t.get(-1090) != 99 || t.get(-5000) != 7)
+			errorOut_("arena table wrong", 4);
+	}
+
+	}
+	passOut_();
+}
+
+// array part alignment: cache lines, huge pages, and changing it with setPolicy
+void HybridTableTester::testS() {
+	funcname_ = "HybridTableTester::testS";
+	{
+
+	// remembers the largest block it handed out
+	class RecordingResource : public std::pmr::memory_resource {
+	public:
+		void* largest = nullptr;
+		size_t largest_size = 0, largest_align = 0;
+	private:
+		void* do_allocate(size_t size, size_t align) override {
+			void* p = std::pmr::new_delete_resource()->allocate(size, align);
+			if (size >= largest_size) { largest = p; largest_size = size; largest_align = align; }
+			return p;
+		}
+		void do_deallocate(void* p, size_t size, size_t align) override {
+			std::pmr::new_delete_resource()->deallocate(p, size, align);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	};
+
+	// cache line aligned array part, also after growth and in copies
+	RecordingResource recording;
+	HybridTablePolicy policy;
+	policy.array_alignment = 48;
+	HybridTable t(&recording);
+	t.setPolicy(policy);
+	if (t.getPolicy().array_alignment != 64) errorOut_("alignment not rounded to a power of 2: ", t.getPolicy().array_alignment, 1);
+	for(int i = 0; i < 1000; i++) t.set(i, i + 1);
+	if (t.getArraySize() < 1000 || recording.largest_align != 64 || ((uintptr_t)recording.largest % 64) != 0)
+		errorOut_("array part not 64 byte aligned", 2);
+	HybridTable copy(t, &recording);
+	if (recording.largest_align != 64 || copy.getPolicy().array_alignment != 64 || !(copy == t))
+		errorOut_("copy not 64 byte aligned", 2);
+
+	// huge page aligned once the array part is large enough, moved right away by setPolicy
+	vector<int> values(1 << 20);
+	for(int i = 0; i < (1 << 20); i++) values[i] = i ^ 5;
+	HybridTable big(values.data(), 1 << 20, &recording);
+	big.set(-3, 4);
+	if (recording.largest_align > 16) errorOut_("default array part over-aligned", 3);
+	policy.huge_page_bytes = 1 << 20;
+	big.setPolicy(policy);
+	if (recording.largest_align != HybridTable::HUGE_PAGE_SIZE || ((uintptr_t)recording.largest % HybridTable::HUGE_PAGE_SIZE) != 0)
+		errorOut_("large array part not huge page aligned", 3);
+	for(int i = 0; i < (1 << 20); i += 997) {
+		if (big.get(i) != (i ^ 5)) errorOut_("value lost by setPolicy at ", i, 3);
+	}
+	if (big.get(-3) != 4 || big.getArraySize() != (1 << 20)) errorOut_("list part or size changed by setPolicy", 3);
+	policy.huge_page_bytes = 0;
+	policy.array_alignment = 0;
+	big.setPolicy(policy);
+	big.set(1 << 20, 1);
+	if (big.get(999) != (999 ^ 5) || big.get(1 << 20) != 1) errorOut_("array part wrong after going back to default alignment", 4);
+
+	}
+	passOut_();
+}
+
+// compile time tables split their entries like HybridTable
+void HybridTableTester::testT() {
+	funcname_ = "HybridTableTester::testT";
+	{
+
+	// built and checked during compilation
+	static constexpr StaticHybridTable<16, 4> table = {{0, 7}, {1, 3}, {-5, 2}, {2, 1}, {3, 9}, {4, 4}, {100, 6}, {1, 8}};
+	static_assert(table.get(1) == 8 && table.get(4) == 4 && table.get(-5) == 2 && table.get(100) == 6 && table.get(50) == 0);
+	static_assert(table.getArraySize() == 4 && table.getTotalSize() == 7);
+	constexpr StaticHybridTable<4, 0> empty;
+	static_assert(empty.get(0) == 0 && empty.getArraySize() == 4);
+	// counting up keeps up to 255 entries in the list part before they fit the 75% rule
+	constexpr StaticHybridTable<1024, 255> generated = [] {
+		StaticHybridTable<1024, 255> t;
+		for(int i = 0; i < 1000; i++) t.set(i, i * i);
+		t.set(-1, 1);
+		return t;
+	}();
+	static_assert(generated.get(999) == 999 * 999 && generated.getArraySize() == 1024 && generated.get(-1) == 1);
+
+	HybridTable expected;
+	expected.set(0, 7); expected.set(1, 3); expected.set(-5, 2); expected.set(2, 1);
+	expected.set(3, 9); expected.set(4, 4); expected.set(100, 6); expected.set(1, 8);
+	if (table.toString() != expected.toString()) errorOut_("toString differs: ", table.toString(), 1);
+
+	// same split as HybridTable for random sequences of sets
+	mt19937 rng(43);
+	for(int round = 0; round < 50; round++) {
+		StaticHybridTable<1 << 12, 256> fixed;
+		HybridTable t;
+		for(int k = 0; k < 100; k++) {
+			int index = (int)(rng() % 600) - 100;
+			if (rng() % 8 == 0) index *= 5;
+			int val = (int)(rng() % 50);
+			fixed.set(index, val);
+			t.set(index, val);
+		}
+		if (fixed.getArraySize() != t.getArraySize() || fixed.getTotalSize() != t.getTotalSize() || fixed.toString() != t.toString())
+			errorOut_("differs from HybridTable in round ", round, 2);
+		for(int index = -600; index < 3000; index += 7) {
+			if (fixed.get(index) != t.get(index)) errorOut_("get differs at ", index, 2);
+		}
+	}
+
+	}
+	passOut_();
+}
+
+// exportColumns/importColumns round trips; malformed columns are rejected
+void HybridTableTester::testU() {
+	funcname_ = "HybridTableTester::testU";
+	{
+
+	// export: a view of the array part and the list part packed
+	vector<int> evens(20);
+	for(int i = 0; i < 20; i++) evens[i] = i * 2;
+	HybridTable t(evens.data(), 20);
+	t.set(-7, 1); t.set(500, 2); t.set(-2, 3);
+	HybridTableColumns columns = t.exportColumns();
+	if ((int)columns.array_values.size() != t.getArraySize()) errorOut_("array column has the wrong size", 1);
+	for(int i = 0; i < t.getArraySize(); i++) {
+		if (columns.array_values[i] != t.get(i)) errorOut_("array column wrong at ", i, 1);
+	}
+	if (columns.list_indices != vector<int>({-7, -2, 500}) || columns.list_values != vector<int>({1, 3, 2}))
+		errorOut_("list columns wrong", 1);
+	t.set(3, 99);
+	if (columns.array_values[3] != 99) errorOut_("array column is a copy", 1);
+	t.compact();
+	if (t.exportColumns().list_indices != columns.list_indices) errorOut_("compact list exported wrong", 1);
+
+	// import reproduces the table, also from its own columns
+	HybridTable u;
+	u.enablePresenceBitmap();
+	if (!u.importColumns(t.exportColumns()) || u.toString() != t.toString() || !(u == t)) errorOut_("import differs: ", u.toString(), 2);
+	if (u.getLiveSize() != u.getTotalSize() - 1) errorOut_("presence bitmap not rebuilt", 2);
+	if (!u.importColumns(u.exportColumns()) || u.toString() != t.toString()) errorOut_("import from itself failed", 2);
+	HybridTable small;
+	small.set(1, 5);
+	if (!u.importColumns(small.exportColumns()) || u.toString() != small.toString()) errorOut_("import of a small table failed", 2);
+
+	// malformed columns change nothing
+	HybridTableColumns bad = t.exportColumns();
+	bad.list_values.pop_back();
+	HybridTableColumns unsorted = t.exportColumns();
+	swap(unsorted.list_indices[0], unsorted.list_indices[1]);
+	HybridTableColumns overlapping = t.exportColumns();
+	overlapping.list_indices.push_back(5);
+	overlapping.list_values.push_back(5);
+	if (u.importColumns(bad) || u.importColumns(unsorted) || u.importColumns(overlapping)) errorOut_("malformed columns accepted", 3);
+	if (u.toString() != small.toString()) errorOut_("malformed columns changed the table", 3);
+
+	// importing loose columns is the same as bulkLoad
+	mt19937 rng(47);
+	vector<int> indices(5000), values(5000);
+	vector<pair<int, int>> entries(5000);
+	for(int k = 0; k < 5000; k++) {
+		indices[k] = (int)(rng() % 20000) - 2000;
+		values[k] = (int)rng();
+		entries[k] = make_pair(indices[k], values[k]);
+	}
+	HybridTable loaded, imported;
+	loaded.bulkLoad(entries.data(), entries.size());
+	imported.importColumns(indices.data(), values.data(), indices.size());
+	if (!(loaded == imported) || loaded.getArraySize() != imported.getArraySize()) errorOut_("loose column import differs", 4);
+
+	}
+	passOut_();
+}
+
+// fromString parses toString() output and rejects anything else
+void HybridTableTester::testV() {
+	funcname_ = "HybridTableTester::testV";
+	{
+
+	// round trips, whatever the numbers and the split between the parts
+	mt19937 rng(53);
+	for(int round = 0; round < 30; round++) {
+		HybridTable t;
+		int entries = (int)(rng() % 300);
+		for(int k = 0; k < entries; k++) {
+			int index = (round % 3 == 0) ? (int)rng() : (int)(rng() % 1000) - 200;
+			int val = (round % 2 == 0) ? (int)rng() : (int)(rng() % 10);
+			t.set(index, val);
+		}
+		if (round == 1) { t.set(INT_MIN, INT_MIN); t.set(INT_MAX, INT_MAX); t.set(3, -1); }
+		if (round == 2) t.compact();
+		HybridTable parsed;
+		if (!parsed.fromString(t.toString()) || parsed.toString() != t.toString() || parsed.getArraySize() != t.getArraySize())
+			errorOut_("round trip failed in round ", round, 1);
+	}
+	vector<int> none;
+	HybridTable no_array(none.data(), 0), parsed;
+	if (!parsed.fromString(no_array.toString()) || parsed.getArraySize() != 0 || parsed.toString() != "") errorOut_("empty table failed", 1);
+	no_array.set(-9, 12345678);
+	if (!parsed.fromString(no_array.toString()) || parsed.toString() != no_array.toString())
+		errorOut_("table without array part failed: ", no_array.toString(), 1);
+
+	// anything else is rejected and leaves the table alone
+	HybridTable before(parsed);
+	const char* bad[] = {"0 : 2147483648", "0 : -2147483649", "0 : 12345678901", "0 : 1\n", "1 : 5", "0 : 1\n2 : 2",
+		"0 : 1\n---\n", "0 : 1\n---\n5 : 1 -->", "0 :1", "0 : +1", "0 : 1\n---\n0 : 1", "0 : 1\n---\n9 : 1 --> 7 : 1", "-"};
+	for(const char* text : bad) {
+		if (parsed.fromString(text)) errorOut_("accepted ", text, 2);
+	}
+	if (!(parsed == before) || parsed.toString() != before.toString()) errorOut_("rejected text changed the table", 2);
+	if (!parsed.fromString("0 : -2147483648\n1 : 2147483647\n2 : 00000012\n---\n-1 : -0") || parsed.get(0) != INT_MIN
+	    || parsed.get(1) != INT_MAX || parsed.get(2) != 12 || parsed.getTotalSize() != 4)
+		errorOut_("edge numbers parsed wrong: ", parsed.toString(), 2);
+
+	}
+	passOut_();
+}
+
+// run length compressed array part: memory, writes, recompress, growth
+void HybridTableTester::testW() {
+	funcname_ = "HybridTableTester::testW";
+	{
+
+	// a run heavy table: zeros with a few stretches of a sentinel
+	vector<int> values(1 << 20, 0);
+	fill(values.begin() + 1000, values.begin() + 90000, -1);
+	fill(values.begin() + 500000, values.begin() + 500100, 7);
+	values[700000] = 3;
+	HybridTable plain(values.data(), 1 << 20);
+	plain.set(-4, 2); plain.set(5000000, 1);
+	CompressedHybridTable compressed(plain);
+	if (compressed.getArraySize() != plain.getArraySize() || compressed.getTotalSize() != plain.getTotalSize())
+		errorOut_("sizes differ", 1);
+	if (compressed.memoryUsage().total() * 10 > plain.memoryUsage().total())
+		errorOut_("not 10x smaller: ", (int)compressed.memoryUsage().total(), 1);
+	if (compressed.getExpandedBlockCount() != 0) errorOut_("blocks expanded by compression", 1);
+	for(int i = -10; i < (1 << 20); i += 37) {
+		if (compressed.get(i) != plain.get(i)) errorOut_("get differs at ", i, 1);
+	}
+	if (compressed.get(89999) != -1 || compressed.get(90000) != 0 || compressed.get(700000) != 3 || compressed.get(5000000) != 1)
+		errorOut_("run edges wrong", 1);
+
+	// writes of the value already there expand nothing, others one block
+	compressed.set(2000, -1);
+	compressed.set(600000, 0);
+	if (compressed.getExpandedBlockCount() != 0) errorOut_("unchanged write expanded a block", 2);
+	compressed.set(600001, 9);
+	plain.set(600001, 9);
+	if (compressed.getExpandedBlockCount() != 1 || compressed.get(600001) != 9 || compressed.get(600002) != 0)
+		errorOut_("write to a run wrong", 2);
+	compressed.set(600001, 0);
+	plain.set(600001, 0);
+	compressed.recompress();
+	if (compressed.getExpandedBlockCount() != 0) errorOut_("recompress left a uniform block expanded", 2);
+	HybridTable back = compressed.decompress();
+	if (!(back == plain) || back.getArraySize() != plain.getArraySize() || back.toString() != plain.toString())
+		errorOut_("decompress differs", 2);
+
+	// set() grows the array part and moves list entries exactly like HybridTable
+	mt19937 rng(61);
+	for(int round = 0; round < 20; round++) {
+		HybridTable t;
+		CompressedHybridTable c;
+		for(int k = 0; k < 400; k++) {
+			int index = (int)(rng() % 3000) - 100;
+			int val = (rng() % 4 == 0) ? (int)(rng() % 5) : 1;
+			t.set(index, val);
+			c.set(index, val);
+		}
+		if (c.getArraySize() != t.getArraySize() || c.toString() != t.toString()) errorOut_("differs from HybridTable in round ", round, 3);
+	}
+	vector<int> ones(5000, 1);
+	HybridTable big(ones.data(), 5000);
+	CompressedHybridTable grown(big);
+	for(int i = 5000; i < 9000; i++) {
+		big.set(i, 1);
+		grown.set(i, 1);
+	}
+	if (grown.getArraySize() != big.getArraySize() || grown.toString() != big.toString()) errorOut_("growth over blocks differs", 3);
+
+	}
+	passOut_();
+}
+
+// matrix of hybrid rows: get, row sizes, out of range rows, products
+void HybridTableTester::testX() {
+	funcname_ = "HybridTableTester::testX";
+	{
+
+	// dense, sparse and mixed rows, with entries outside the columns left out
+	const int rows = 300, cols = 5000;
+	mt19937 rng(71);
+	vector<HybridTable> tables(rows);
+	for(int r = 0; r < rows; r++) {
+		if (r % 3 == 0) {
+			vector<int> dense(r * 20 + 1);
+			for(int& val : dense) val = (int)(rng() % 21) - 10;
+			tables[r] = HybridTable(dense.data(), (int)dense.size());
+		}
+		for(int k = 0; k < 30; k++) tables[r].set((int)(rng() % (cols + 200)) - 100, (int)(rng() % 21) - 10);
+	}
+	HybridMatrix matrix(tables.data(), rows, cols);
+	if (matrix.getRowCount() != rows || matrix.getColumnCount() != cols) errorOut_("matrix size wrong", 1);
+	for(int r = 0; r < rows; r++) {
+		if (matrix.getDenseSize(r) != std::min(tables[r].getArraySize(), cols)) errorOut_("dense size wrong in row ", r, 1);
+		for(int c = -5; c < cols + 5; c += 3) {
+			int expected = ((c >= 0) && (c < cols)) ? tables[r].get(c) : 0;
+			if (matrix.get(r, c) != expected) errorOut_("get wrong in row ", r, 1);
+		}
+	}
+	for(int r : {-1, rows, INT_MAX}) {
+		if (matrix.get(r, 0) != 0 || matrix.getDenseSize(r) != 0 || matrix.getListSize(r) != 0)
+			errorOut_("out of range row not empty: ", r, 1);
+	}
+
+	// the product matches the sum of get() products; small integers keep doubles exact
+	vector<double> x(cols), y(rows), y_parallel(rows);
+	for(double& val : x) val = (double)((int)(rng() % 7) - 3);
+	vector<double> expected(rows, 0);
+	for(int r = 0; r < rows; r++) {
+		for(int c = 0; c < cols; c++) expected[r] += tables[r].get(c) * x[c];
+	}
+	matrix.multiply(x.data(), y.data());
+	if (y != expected) errorOut_("product wrong", 2);
+
+	vector<HybridTable> big_rows(64);
+	vector<int> dense(4096);
+	for(int r = 0; r < 64; r++) {
+		for(int& val : dense) val = (int)(rng() % 5);
+		big_rows[r] = HybridTable(dense.data(), 4096 - r * 30);
+		big_rows[r].set(9000 + r, 2);
+	}
+	HybridMatrix big(big_rows.data(), 64, 10000);
+	vector<double> big_x(10000, 1.0), big_y(64), big_y_parallel(64);
+	ThreadPool pool(4);
+	big.multiply(big_x.data(), big_y.data());
+	big.multiply(big_x.data(), big_y_parallel.data(), &pool);
+	for(int r = 0; r < 64; r++) {
+		if (big_y[r] != (double)big_rows[r].sum(0, 10000) || big_y_parallel[r] != big_y[r]) errorOut_("parallel product wrong in row ", r, 2);
+	}
+
+	HybridMatrix empty;
+	if (empty.getRowCount() != 0 || empty.get(0, 0) != 0) errorOut_("empty matrix wrong", 3);
+
+	}
+	passOut_();
+}
+
 void HybridTableTester::errorOut_(const string& errMsg, unsigned int errBit) {
 
 	cerr << funcname_ << ":" << " fail" << errBit << ": ";
@@ -48,6 +48,78 @@ public:
 	// unused
 	void testz();
 
+	// memory usage, compact list part
+	void testA();
+
+	// inline storage for small tables
+	void testB();
+
+	// growth policy
+	void testC();
+
+	// presence bitmap
+	void testD();
+
+	// range aggregates
+	void testE();
+
+	// prefix sum index
+	void testF();
+
+	// merge
+	void testG();
+
+	// bulk load, parallel merge
+	void testH();
+
+	// list finger, set with hint
+	void testI();
+
+	// list filter
+	void testJ();
+
+	// freeze, frozen lookups and serialization
+	void testK();
+
+	// journal, replay and compaction
+	void testL();
+
+	// background snapshot
+	void testM();
+
+	// concurrent table, buffered writers
+	void testN();
+
+	// add, fetchAdd, exchange, compareExchange
+	void testO();
+
+	// versioned reads
+	void testP();
+
+	// equality, hash, diff and patch
+	void testQ();
+
+	// memory resources
+	void testR();
+
+	// aligned and huge page array parts
+	void testS();
+
+	// compile time tables
+	void testT();
+
+	// column export and import
+	void testU();
+
+	// parsing toString() text
+	void testV();
+
+	// run length compressed array part
+	void testW();
+
+	// matrix of hybrid rows
+	void testX();
+
 private:
 
 	// three overloaded versions
@@ -34,7 +34,31 @@ int main(int argc, char* argv[]) {
 		case 'x': { HybridTableTester t; t.testx(); } break;
 		case 'y': { HybridTableTester t; t.testy(); } break;
 		case 'z': { HybridTableTester t; t.testz(); } break;
-		default: { cout << "Options are a -- y." << endl; } break;
+		case 'A': { HybridTableTester t; t.testA(); } break;
+		case 'B': { HybridTableTester t; t.testB(); } break;
+		case 'C': { HybridTableTester t; t.testC(); } break;
+		case 'D': { HybridTableTester t; t.testD(); } break;
+		case 'E': { HybridTableTester t; t.testE(); } break;
+		case 'F': { HybridTableTester t; t.testF(); } break;
+		case 'G': { HybridTableTester t; t.testG(); } break;
+		case 'H': { HybridTableTester t; t.testH(); } break;
+		case 'I': { HybridTableTester t; t.testI(); } break;
+		case 'J': { HybridTableTester t; t.testJ(); } break;
+		case 'K': { HybridTableTester t; t.testK(); } break;
+		case 'L': { HybridTableTester t; t.testL(); } break;
+		case 'M': { HybridTableTester t; t.testM(); } break;
+		case 'N': { HybridTableTester t; t.testN(); } break;
+		case 'O': { HybridTableTester t; t.testO(); } break;
+		case 'P': { HybridTableTester t; t.testP(); } break;
+		case 'Q': { HybridTableTester t; t.testQ(); } break;
+		case 'R': { HybridTableTester t; t.testR(); } break;
+		case 'S': { HybridTableTester t; t.testS(); } break;
+		case 'T': { HybridTableTester t; t.testT(); } break;
+		case 'U': { HybridTableTester t; t.testU(); } break;
+		case 'V': { HybridTableTester t; t.testV(); } break;
+		case 'W': { HybridTableTester t; t.testW(); } break;
+		case 'X': { HybridTableTester t; t.testX(); } break;
+		default: { cout << "Options are a -- y, A -- X." << endl; } break;
 	       	}
 	}
 	return 0;
@@ -0,0 +1,39 @@
+#include "HybridTableWriter.h"
+#include "ConcurrentHybridTable.h"
+
+using namespace std;
+
+HybridTableWriter::HybridTableWriter(ConcurrentHybridTable& table, size_t batch_size)
+    : table_(table), batch_size_(batch_size > 0 ? batch_size : 1) {
+    pending_.reserve(batch_size_);
+}
+
+HybridTableWriter::~HybridTableWriter() {
+    flush();
+}
+
+void HybridTableWriter::set(int i, int val) {
+    pending_.push_back(pair<int, int>(i, val));
+    if(pending_.size() >= batch_size_){
+        flush();
+    }
+}
+
+void HybridTableWriter::flush() {
+    if(pending_.empty()){
+        return;
+    }
+
+    // sort and coalesce outside the lock; the presence bitmap keeps the
+    // batch's unset array slots from overwriting the shared table's values
+    HybridTable batch;
+    batch.enablePresenceBitmap();
+    batch.bulkLoad(pending_.data(), pending_.size());
+    pending_.clear();
+
+    table_.merge(batch, MergeCombiner::OVERWRITE);
+}
+
+size_t HybridTableWriter::getPendingCount() const {
+    return pending_.size();
+}
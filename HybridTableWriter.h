@@ -0,0 +1,46 @@
+#ifndef HYBRIDTABLEWRITER_H_
+#define HYBRIDTABLEWRITER_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+class ConcurrentHybridTable;
+
+// A per thread write buffer in front of a ConcurrentHybridTable. set()
+// only appends to a local buffer; flush() sorts the buffer into a small
+// HybridTable (bulkLoad(), so the last set() of an index wins) without
+// holding any lock, then merges it into the shared table under a single
+// exclusive lock. Other threads see the buffered values only after the
+// flush. A writer must not be shared between threads.
+class HybridTableWriter {
+
+public:
+	static constexpr size_t DEFAULT_BATCH_SIZE = 4096;
+
+	// Buffers for table; set() flushes once batch_size updates are buffered.
+	explicit HybridTableWriter(ConcurrentHybridTable& table, size_t batch_size = DEFAULT_BATCH_SIZE);
+
+	// Flushes what is left.
+	~HybridTableWriter();
+
+	HybridTableWriter(const HybridTableWriter&) = delete;
+	HybridTableWriter& operator=(const HybridTableWriter&) = delete;
+
+	// Buffers set(i, val) for the shared table.
+	void set(int i, int val);
+
+	// Writes the buffered updates to the shared table.
+	void flush();
+
+	// Returns the number of updates buffered (repeats included).
+	size_t getPendingCount() const;
+
+private:
+
+	ConcurrentHybridTable& table_;
+	size_t batch_size_;
+	std::vector<std::pair<int, int> > pending_;
+};
+
+#endif /* HYBRIDTABLEWRITER_H_ */
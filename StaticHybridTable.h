@@ -0,0 +1,203 @@
+#ifndef STATICHYBRIDTABLE_H_
+#define STATICHYBRIDTABLE_H_
+
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include "HybridTable.h"
+
+// A fixed capacity HybridTable that can be built during compilation, for
+// lookup tables that should cost nothing at process start:
+//
+//     constexpr StaticHybridTable<64, 8> table = {{0, 7}, {1, 3}, {-5, 2}};
+//
+// The entries are set in order exactly as HybridTable::set() would on an
+// empty table with the default HybridTablePolicy, so the array part grows
+// the same way (to the largest power of 2 that would be at least 75% full)
+// and get(), getArraySize() and toString() give the same results. A
+// constexpr instance is plain read-only data. ArrayCapacity bounds the
+// array part size and ListCapacity the number of list entries; running
+// out of either is a compile error for a constexpr table, and aborts one
+// built at run time.
+template<int ArrayCapacity, int ListCapacity>
+class StaticHybridTable {
+
+	static_assert(ArrayCapacity >= HybridTable::INITIAL_ARRAY_SIZE, "the array part starts with INITIAL_ARRAY_SIZE slots");
+	static_assert(ListCapacity >= 0, "ListCapacity can not be negative");
+
+public:
+	// Constructs an empty table: INITIAL_ARRAY_SIZE zeros in the array
+	// part and an empty list part.
+	constexpr StaticHybridTable() {}
+
+	// Constructs the table by calling set(index, val) for every entry,
+	// in order.
+	constexpr StaticHybridTable(std::initializer_list<std::pair<int, int>> entries) {
+		for(const std::pair<int, int>& entry : entries){
+			set(entry.first, entry.second);
+		}
+	}
+
+	// Same as HybridTable::set(i, val).
+	constexpr void set(int i, int val) {
+		if((i >= 0) && (i < array_size_)){
+			array_[i] = val;
+			return;
+		}
+		int position = lowerBound(i);
+		if((position < list_size_) && (list_indices_[position] == i)){
+			list_values_[position] = val;
+			return;
+		}
+
+		int new_size = newArraySize(i, position);
+		if(new_size > array_size_){
+			growArray(new_size);
+			if((i >= 0) && (i < array_size_)){
+				array_[i] = val;
+				return;
+			}
+			position = lowerBound(i);
+		}
+		insertEntry(position, i, val);
+	}
+
+	// Returns the value corresponding to index i, or 0 if not present.
+	constexpr int get(int i) const {
+		if((i >= 0) && (i < array_size_)){
+			return array_[i];
+		}
+		int position = lowerBound(i);
+		if((position < list_size_) && (list_indices_[position] == i)){
+			return list_values_[position];
+		}
+		return 0;
+	}
+
+	// Returns the number of entries of the array part.
+	constexpr int getArraySize() const { return array_size_; }
+
+	// Returns the total number of elements in the array part and the
+	// list part.
+	constexpr int getTotalSize() const { return array_size_ + list_size_; }
+
+	// Same format as HybridTable::toString().
+	std::string toString() const {
+		std::string out_string;
+		for(int itr = 0; itr < array_size_; itr++){
+			out_string += std::to_string(itr) + " : " + std::to_string(array_[itr]);
+			if(itr < array_size_ - 1){
+				out_string += "\n";
+			}
+		}
+		if(list_size_ > 0){
+			out_string += "\n---\n";
+			for(int itr = 0; itr < list_size_; itr++){
+				if(itr != 0){
+					out_string += " --> ";
+				}
+				out_string += std::to_string(list_indices_[itr]) + " : " + std::to_string(list_values_[itr]);
+			}
+		}
+		return out_string;
+	}
+
+private:
+
+    static constexpr int LIST_STORAGE = ListCapacity > 0 ? ListCapacity : 1;
+
+    int array_[ArrayCapacity] = {};
+    int list_indices_[LIST_STORAGE] = {}; // list part, sorted by index
+    int list_values_[LIST_STORAGE] = {};
+    int array_size_ = HybridTable::INITIAL_ARRAY_SIZE;
+    int list_size_ = 0;
+
+    // not constexpr, so reaching it while building a constexpr table fails to compile
+    static void capacityExceeded() {
+        std::abort();
+    }
+
+    // returns the position of the first list entry with an index >= i
+    constexpr int lowerBound(int i) const {
+        int lo = 0;
+        int hi = list_size_;
+        while(lo < hi){
+            int mid = lo + (hi - lo) / 2;
+            if(list_indices_[mid] < i){
+                lo = mid + 1;
+            }
+            else{
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // HybridTable::nextPossibleArraySize with the default policy
+    static constexpr long long nextPossibleArraySize(long long size) {
+        long long next_size = 1;
+        while(next_size <= size){
+            next_size <<= 1;
+        }
+        return next_size << (HybridTablePolicy().growth_shift - 1);
+    }
+
+    // HybridTable::calcNewArraySize over the list with index i inserted at position
+    constexpr int newArraySize(int i, int position) const {
+        constexpr HybridTablePolicy policy;
+        int out_size = array_size_;
+        long long used_size = array_size_;
+        long long next_size = nextPossibleArraySize(array_size_);
+        for(int itr = 0; itr <= list_size_; itr++){
+            int index = (itr < position) ? list_indices_[itr] : (itr == position) ? i : list_indices_[itr - 1];
+            if((index < next_size) && (index >= 0)){
+                used_size++;
+            }
+            if((used_size * 100 >= next_size * policy.density_percent) && (next_size <= policy.max_array_size)){
+                out_size = (int)next_size;
+            }
+            if(index >= next_size){
+                next_size = nextPossibleArraySize(next_size);
+                used_size++;
+            }
+        }
+        return out_size;
+    }
+
+    // grows the array part to size slots and moves the list entries that now fit into it
+    constexpr void growArray(int size) {
+        if(size > ArrayCapacity){
+            capacityExceeded();
+        }
+        int kept = 0;
+        for(int itr = 0; itr < list_size_; itr++){
+            int index = list_indices_[itr];
+            if((index >= 0) && (index < size)){
+                array_[index] = list_values_[itr];
+                continue;
+            }
+            list_indices_[kept] = index;
+            list_values_[kept] = list_values_[itr];
+            kept++;
+        }
+        list_size_ = kept;
+        array_size_ = size;
+    }
+
+    // inserts (i, val) into the list part before position
+    constexpr void insertEntry(int position, int i, int val) {
+        if(list_size_ >= ListCapacity){
+            capacityExceeded();
+        }
+        for(int itr = list_size_; itr > position; itr--){
+            list_indices_[itr] = list_indices_[itr - 1];
+            list_values_[itr] = list_values_[itr - 1];
+        }
+        list_indices_[position] = i;
+        list_values_[position] = val;
+        list_size_++;
+    }
+};
+
+#endif /* STATICHYBRIDTABLE_H_ */
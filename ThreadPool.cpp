@@ -0,0 +1,80 @@
+#include "ThreadPool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int threads) {
+    for(int itr=1; itr < threads; itr++){
+        workers_.push_back(thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for(thread& worker : workers_){
+        worker.join();
+    }
+}
+
+int ThreadPool::size() const {
+    return (int)workers_.size() + 1;
+}
+
+void ThreadPool::run(int count, const function<void(int)>& task) {
+    if(count <= 0){
+        return;
+    }
+    if(workers_.empty() || (count == 1)){
+        for(int itr=0; itr < count; itr++){
+            task(itr);
+        }
+        return;
+    }
+
+    lock_guard<mutex> run_lock(run_mutex_);
+    {
+        lock_guard<mutex> lock(mutex_);
+        task_ = &task;
+        task_count_ = count;
+        next_task_ = 0;
+        busy_ = (int)workers_.size();
+        job_++;
+    }
+    wake_.notify_all();
+
+    // the caller works too, then waits for the stragglers
+    drain();
+    unique_lock<mutex> lock(mutex_);
+    done_.wait(lock, [this]{ return busy_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+    unsigned long seen_job = 0;
+    while(true){
+        {
+            unique_lock<mutex> lock(mutex_);
+            wake_.wait(lock, [&]{ return stopping_ || (job_ != seen_job); });
+            if(stopping_){
+                return;
+            }
+            seen_job = job_;
+        }
+
+        drain();
+
+        lock_guard<mutex> lock(mutex_);
+        if(--busy_ == 0){
+            done_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::drain() {
+    for(int itr = next_task_++; itr < task_count_; itr = next_task_++){
+        (*task_)(itr);
+    }
+}
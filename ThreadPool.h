@@ -0,0 +1,57 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for splitting loops over HybridTable data.
+// The threads are started once and reused by every run() call.
+class ThreadPool {
+
+public:
+	// Starts threads-1 workers; the thread calling run() is the last one.
+	// threads < 1 is treated as 1 (everything runs on the calling thread).
+	explicit ThreadPool(int threads);
+
+	// Stops and joins the workers.
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Returns the number of threads run() uses, including the caller.
+	int size() const;
+
+	// Calls task(0) .. task(count-1), spread over all threads, and returns
+	// once every call has finished. Calls from several threads are run one
+	// after the other.
+	void run(int count, const std::function<void(int)>& task);
+
+private:
+
+	std::vector<std::thread> workers_;
+
+	std::mutex run_mutex_;               // one run() at a time
+	std::mutex mutex_;                   // guards everything below
+	std::condition_variable wake_;       // a new job or stopping_
+	std::condition_variable done_;       // busy_ reached 0
+
+	const std::function<void(int)>* task_ = nullptr; // current job
+	int task_count_ = 0;
+	std::atomic<int> next_task_{0};      // next task number to hand out
+	int busy_ = 0;                       // workers not yet done with the current job
+	unsigned long job_ = 0;              // incremented for every job
+	bool stopping_ = false;
+
+	// waits for jobs until stopping_
+	void workerLoop();
+
+	// takes task numbers of the current job until there are none left
+	void drain();
+};
+
+#endif /* THREADPOOL_H_ */
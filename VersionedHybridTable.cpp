@@ -0,0 +1,234 @@
+#include "VersionedHybridTable.h"
+#include <algorithm>
+
+using namespace std;
+
+int VersionedHybridTable::ReadView::get(int i) const {
+    if((i < version_->array_size) && (i >= 0)){
+        return (*version_->chunks[i >> CHUNK_SHIFT])[i & (CHUNK_SIZE - 1)];
+    }
+
+    // the last segment starting at or before i
+    const vector<shared_ptr<const List> >& segments = version_->segments;
+    vector<shared_ptr<const List> >::const_iterator segment = upper_bound(segments.begin(), segments.end(), i, [](int index, const shared_ptr<const List>& entries){
+        return index < entries->front().first;
+    });
+    if(segment == segments.begin()){
+        return 0;
+    }
+    const List& list = **(segment - 1);
+    List::const_iterator found = lower_bound(list.begin(), list.end(), i, [](const pair<int, int>& entry, int index){
+        return entry.first < index;
+    });
+    if((found != list.end()) && (found->first == i)){
+        return found->second;
+    }
+    return 0;
+}
+
+unsigned long long VersionedHybridTable::ReadView::getVersion() const {
+    return version_->number;
+}
+
+int VersionedHybridTable::ReadView::getArraySize() const {
+    return version_->array_size;
+}
+
+int VersionedHybridTable::ReadView::getTotalSize() const {
+    return version_->array_size + version_->list_size;
+}
+
+string VersionedHybridTable::ReadView::toString() const {
+    string out_string;
+
+    for(int itr = 0; itr < version_->array_size; itr++){
+        out_string += to_string(itr) + " : " + to_string(get(itr));
+        if(itr < version_->array_size - 1){
+            out_string += "\n";
+        }
+    }
+    if(version_->list_size > 0){
+        out_string += "\n---\n";
+        bool first = true;
+        for(const shared_ptr<const List>& segment : version_->segments){
+            for(const pair<int, int>& entry : *segment){
+                if(!first){
+                    out_string += " --> ";
+                }
+                out_string += to_string(entry.first) + " : " + to_string(entry.second);
+                first = false;
+            }
+        }
+    }
+    return out_string;
+}
+
+VersionedHybridTable::VersionedHybridTable() {
+    publish(buildVersion(0));
+}
+
+VersionedHybridTable::VersionedHybridTable(const HybridTable& table) : table_(table) {
+    publish(buildVersion(0));
+}
+
+VersionedHybridTable::ReadView VersionedHybridTable::pin() const {
+    ReadView view;
+    view.version_ = latest();
+    return view;
+}
+
+int VersionedHybridTable::get(int i) const {
+    return pin().get(i);
+}
+
+void VersionedHybridTable::set(int i, int val) {
+    pair<int, int> entry(i, val);
+    set(&entry, 1);
+}
+
+void VersionedHybridTable::set(const pair<int, int>* entries, size_t count) {
+    lock_guard<mutex> lock(write_mutex_);
+
+    shared_ptr<const Version> previous = latest();
+    for(size_t itr = 0; itr < count; itr++){
+        table_.set(entries[itr].first, entries[itr].second);
+    }
+
+    // a resize moves entries between the parts, so everything is built again
+    if(table_.getArraySize() != previous->array_size){
+        publish(buildVersion(previous->number + 1));
+        return;
+    }
+
+    // otherwise copy only the chunks and list segments that were written to
+    shared_ptr<Version> next = make_shared<Version>();
+    next->number = previous->number + 1;
+    next->array_size = previous->array_size;
+    next->chunks = previous->chunks;
+    vector<shared_ptr<Chunk> > copied(next->chunks.size());
+    List list_entries;
+    for(size_t itr = 0; itr < count; itr++){
+        int index = entries[itr].first;
+        if((index < 0) || (index >= next->array_size)){
+            list_entries.push_back(entries[itr]);
+            continue;
+        }
+        shared_ptr<Chunk>& chunk = copied[index >> CHUNK_SHIFT];
+        if(chunk == nullptr){
+            chunk = make_shared<Chunk>(*previous->chunks[index >> CHUNK_SHIFT]);
+            next->chunks[index >> CHUNK_SHIFT] = chunk;
+        }
+        (*chunk)[index & (CHUNK_SIZE - 1)] = entries[itr].second;
+    }
+
+    next->list_size = previous->list_size;
+    if(list_entries.empty()){
+        next->segments = previous->segments;
+    }
+    else{
+        // sort the new entries and keep only the last of a repeated index
+        stable_sort(list_entries.begin(), list_entries.end(), [](const pair<int, int>& a, const pair<int, int>& b){
+            return a.first < b.first;
+        });
+        List updates;
+        for(size_t itr = 0; itr < list_entries.size(); itr++){
+            if((itr + 1 == list_entries.size()) || (list_entries[itr + 1].first != list_entries[itr].first)){
+                updates.push_back(list_entries[itr]);
+            }
+        }
+
+        // a segment takes the updates below the start of the next one; untouched segments are shared
+        const vector<shared_ptr<const List> >& old_segments = previous->segments;
+        next->segments.reserve(old_segments.size() + 1);
+        size_t update = 0;
+        for(size_t segment = 0; segment < old_segments.size(); segment++){
+            size_t run_end = updates.size();
+            if(segment + 1 < old_segments.size()){
+                int next_start = old_segments[segment + 1]->front().first;
+                run_end = lower_bound(updates.begin() + update, updates.end(), next_start, [](const pair<int, int>& entry, int index){
+                    return entry.first < index;
+                }) - updates.begin();
+            }
+            if(run_end == update){
+                next->segments.push_back(old_segments[segment]);
+                continue;
+            }
+
+            const List& old_list = *old_segments[segment];
+            List merged;
+            merged.reserve(old_list.size() + (run_end - update));
+            List::const_iterator old_itr = old_list.begin();
+            for(; update < run_end; update++){
+                while((old_itr != old_list.end()) && (old_itr->first < updates[update].first)){
+                    merged.push_back(*old_itr++);
+                }
+                if((old_itr != old_list.end()) && (old_itr->first == updates[update].first)){
+                    old_itr++;
+                }
+                merged.push_back(updates[update]);
+            }
+            merged.insert(merged.end(), old_itr, old_list.end());
+            next->list_size += (int)(merged.size() - old_list.size());
+            appendSegments(next->segments, std::move(merged));
+        }
+        if(old_segments.empty()){
+            next->list_size = (int)updates.size();
+            appendSegments(next->segments, std::move(updates));
+        }
+    }
+
+    publish(next);
+}
+
+unsigned long long VersionedHybridTable::getVersion() const {
+    return latest()->number;
+}
+
+shared_ptr<const VersionedHybridTable::Version> VersionedHybridTable::latest() const {
+    lock_guard<mutex> lock(current_mutex_);
+    return current_;
+}
+
+void VersionedHybridTable::publish(const shared_ptr<const Version>& version) {
+    shared_ptr<const Version> replaced;   // released after unlocking, it may be the last reference
+    lock_guard<mutex> lock(current_mutex_);
+    replaced = current_;
+    current_ = version;
+}
+
+shared_ptr<VersionedHybridTable::Version> VersionedHybridTable::buildVersion(unsigned long long number) const {
+    shared_ptr<Version> version = make_shared<Version>();
+    version->number = number;
+    version->array_size = table_.getArraySize();
+
+    vector<shared_ptr<Chunk> > chunks;
+    for(int chunk_lo = 0; chunk_lo < version->array_size; chunk_lo += CHUNK_SIZE){
+        chunks.push_back(make_shared<Chunk>(std::min(CHUNK_SIZE, version->array_size - chunk_lo), 0));
+    }
+    List list;
+    table_.forEach([&](int index, int val){
+        if((index >= 0) && (index < version->array_size)){
+            (*chunks[index >> CHUNK_SHIFT])[index & (CHUNK_SIZE - 1)] = val;
+        }
+        else{
+            list.push_back(make_pair(index, val));
+        }
+    });
+    version->chunks.assign(chunks.begin(), chunks.end());
+    version->list_size = (int)list.size();
+    appendSegments(version->segments, std::move(list));
+    return version;
+}
+
+void VersionedHybridTable::appendSegments(vector<shared_ptr<const List> >& segments, List list) {
+    if(list.size() <= 2 * SEGMENT_SIZE){
+        if(!list.empty()){
+            segments.push_back(make_shared<const List>(std::move(list)));
+        }
+        return;
+    }
+    for(size_t start = 0; start < list.size(); start += SEGMENT_SIZE){
+        List::const_iterator end = list.begin() + std::min(start + SEGMENT_SIZE, list.size());
+        segments.push_back(make_shared<const List>(list.cbegin() + start, end));
+    }
+}
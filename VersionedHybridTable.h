@@ -0,0 +1,114 @@
+#ifndef VERSIONEDHYBRIDTABLE_H_
+#define VERSIONEDHYBRIDTABLE_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "HybridTable.h"
+
+// A HybridTable with multi-version reads. Every write publishes a new
+// immutable version; readers pin() one and may call get() on it as often
+// as they like, always seeing that version, while writers go on (a resize
+// that moves list entries into the array part included). Readers only
+// take a lock to copy the pointer to the latest version. A version shares
+// the array part with the previous one in chunks of CHUNK_SIZE slots, and
+// the list part in segments of consecutive indices (about SEGMENT_SIZE
+// entries each): a write copies only the chunks and segments it touches.
+// A version is freed when the last view pinning it goes away.
+// Writers are serialised by a mutex; they also keep a plain HybridTable
+// up to date, which decides when the array part grows.
+class VersionedHybridTable {
+
+	struct Version;
+
+public:
+	static constexpr int CHUNK_SHIFT = 12;
+	static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+	static constexpr size_t SEGMENT_SIZE = 256;   // a segment is split once it holds twice as many
+
+	// A pinned version. Cheap to copy; stays valid (and unchanged) for as
+	// long as it exists, even after the table is gone.
+	class ReadView {
+	public:
+		// Same as HybridTable::get() on the pinned version.
+		int get(int i) const;
+
+		// Returns the version number: 0 for the initial contents, then one more per write.
+		unsigned long long getVersion() const;
+
+		// Same as HybridTable::getArraySize() on the pinned version.
+		int getArraySize() const;
+
+		// Same as HybridTable::getTotalSize() on the pinned version.
+		int getTotalSize() const;
+
+		// Same as HybridTable::toString() on the pinned version.
+		std::string toString() const;
+
+	private:
+		ReadView() = default;   // only pin() makes views, so version_ is never null
+
+		std::shared_ptr<const Version> version_;
+	friend class VersionedHybridTable;
+	};
+
+	// Constructs an empty table, like HybridTable().
+	VersionedHybridTable();
+
+	// Constructs a table holding a copy of table as version 0.
+	explicit VersionedHybridTable(const HybridTable& table);
+
+	VersionedHybridTable(const VersionedHybridTable&) = delete;
+	VersionedHybridTable& operator=(const VersionedHybridTable&) = delete;
+
+	// Returns a view of the latest version.
+	ReadView pin() const;
+
+	// Same as pin().get(i).
+	int get(int i) const;
+
+	// HybridTable::set(), published as a new version.
+	void set(int i, int val);
+
+	// Sets count (index, value) entries in order and publishes them as a
+	// single version, so readers see all of them or none.
+	void set(const std::pair<int, int>* entries, size_t count);
+
+	// Returns the number of the latest version.
+	unsigned long long getVersion() const;
+
+private:
+
+	typedef std::vector<int> Chunk;
+	typedef std::vector<std::pair<int, int> > List; // sorted by index
+
+	struct Version {
+		unsigned long long number = 0;
+		int array_size = 0;
+		int list_size = 0;                                  // entries in all of segments
+		std::vector<std::shared_ptr<const Chunk> > chunks; // array part, CHUNK_SIZE slots each (the last may be short)
+		std::vector<std::shared_ptr<const List> > segments; // list part, in index order, none of them empty
+	};
+
+	std::mutex write_mutex_;                       // one writer at a time
+	HybridTable table_;                            // the latest contents, for writers only
+	mutable std::mutex current_mutex_;             // held only to read or replace current_
+	std::shared_ptr<const Version> current_;       // the latest version
+
+	// returns current_
+	std::shared_ptr<const Version> latest() const;
+
+	// makes version the latest one
+	void publish(const std::shared_ptr<const Version>& version);
+
+	// builds a version from table_, sharing nothing with older ones
+	std::shared_ptr<Version> buildVersion(unsigned long long number) const;
+
+	// appends list to segments, cut into SEGMENT_SIZE pieces if it is more than twice that
+	static void appendSegments(std::vector<std::shared_ptr<const List> >& segments, List list);
+};
+
+#endif /* VERSIONEDHYBRIDTABLE_H_ */